@@ -0,0 +1,45 @@
+#!/bin/bash
+
+#
+# generates synthetic corpora with gen-corpus and sweeps them through bench.
+# usage: ./bench.bash [output directory]
+#
+
+set -e
+
+OUT=${1:-/tmp/json-parser-corpora}
+mkdir -p "$OUT"
+
+gcc -o gen-corpus gen-corpus.c -std=c11 -O2
+gcc -o bench bench.c json-parser.c json-parser-util.c json-parser-mmap.c json-parser-binary.c -std=c11 -O2
+
+# document size
+for SIZE in 64K 1M 16M 256M; do
+    ./gen-corpus -s $SIZE > "$OUT/size-$SIZE.json"
+done
+./bench -n 20 -w 2 "$OUT"/size-64K.json "$OUT"/size-1M.json "$OUT"/size-16M.json
+./bench -n 3 -w 1 "$OUT"/size-256M.json
+
+# nesting depth
+for DEPTH in 1 16 256 1024; do
+    ./gen-corpus -s 16M -d $DEPTH -w 2 -k 2 > "$OUT/depth-$DEPTH.json"
+done
+./bench -n 10 -w 2 "$OUT"/depth-*.json
+
+# wide objects and arrays
+for WIDTH in 16 256 4096; do
+    ./gen-corpus -s 16M -d 1 -k $WIDTH > "$OUT/keys-$WIDTH.json"
+    ./gen-corpus -s 16M -d 1 -w $WIDTH > "$OUT/width-$WIDTH.json"
+done
+./bench -n 10 -w 2 "$OUT"/keys-*.json "$OUT"/width-*.json
+
+# strings, escapes and numbers
+./gen-corpus -s 16M -t 1:0:0 -l 16:256 > "$OUT/strings.json"
+./gen-corpus -s 16M -t 1:0:0 -l 16:256 -e 0.05 -u 0.05 > "$OUT/strings-escaped.json"
+./gen-corpus -s 16M -t 0:1:0 -m 1:0:0 > "$OUT/numbers-int.json"
+./gen-corpus -s 16M -t 0:1:0 -m 0:1:1 > "$OUT/numbers-real.json"
+./bench -n 10 -w 2 "$OUT"/strings*.json "$OUT"/numbers-*.json
+
+# many small documents
+./gen-corpus -s 16M --ndjson -d 2 > "$OUT/records.ndjson"
+./bench -n 10 -w 2 --ndjson "$OUT"/records.ndjson
@@ -0,0 +1,593 @@
+//
+// benchmark harness for json-parser
+//
+// runs each given corpus for a number of iterations (after warm-up) and 
+// reports throughput for parsing, iterating, converting and deleting 
+// documents separately. NDJSON corpora (one document per line) are 
+// supported with --ndjson. allocs/doc counts allocator calls for the 
+// parse phase and node deallocations for the delete phase. --binary adds 
+// phases for encoding to CBOR and MessagePack, from the tree and 
+// directly from the source, and for decoding the encoded documents
+//
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "json-parser.h"
+#include "json-parser-util.h"
+#include "json-parser-mmap.h"
+#include "json-parser-binary.h"
+
+#include <time.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_SIZE 4096
+
+typedef struct node_chunk {
+    JsonNode_t* current_node;
+    JsonNode_t* max_node;
+    struct node_chunk* next;
+    JsonNode_t nodes[CHUNK_SIZE];
+} node_chunk_t;
+
+//
+// bump allocator that keeps its chunks between documents 
+// so steady-state parsing does not measure malloc
+//
+typedef struct {
+    node_chunk_t* first;
+    node_chunk_t* last;
+    size_t alloc_count;
+    size_t dealloc_count;
+} bench_allocator_t;
+
+static node_chunk_t* new_node_chunk(void) {
+    node_chunk_t* chunkptr = (node_chunk_t*)malloc(sizeof(node_chunk_t));
+    chunkptr->next = NULL;
+    chunkptr->current_node = chunkptr->nodes;
+    chunkptr->max_node = chunkptr->nodes + CHUNK_SIZE;
+    return chunkptr;
+}
+
+static JsonNode_t* bench_alloc(void* const alloc_data) {
+    bench_allocator_t* const bump = (bench_allocator_t*)alloc_data;
+    node_chunk_t* nodes = bump->last;
+
+    bump->alloc_count++;
+
+    if(nodes->current_node == nodes->max_node) {
+        if(nodes->next == NULL)
+            nodes->next = new_node_chunk();
+        bump->last = nodes->next;
+        nodes = bump->last;
+        nodes->current_node = nodes->nodes;
+    }
+
+    JsonNode_t* node = nodes->current_node++;
+    node->type = JsonNodeType_none;
+    node->flags = 0u;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.next      = NULL;
+    node->pair.value     = NULL;
+    return node;
+}
+
+//
+// hands out whatever is left of the current chunk
+//
+static JsonNode_t* bench_alloc_block(void* const alloc_data, size_t* count) {
+    bench_allocator_t* const bump = (bench_allocator_t*)alloc_data;
+    node_chunk_t* nodes = bump->last;
+
+    bump->alloc_count++;
+
+    if(nodes->current_node == nodes->max_node) {
+        if(nodes->next == NULL)
+            nodes->next = new_node_chunk();
+        bump->last = nodes->next;
+        nodes = bump->last;
+        nodes->current_node = nodes->nodes;
+    }
+
+    JsonNode_t* block = nodes->current_node;
+    *count = (size_t)(nodes->max_node - block);
+    nodes->current_node = nodes->max_node;
+    return block;
+}
+
+static void bench_dealloc(void* const alloc_data, JsonNode_t* node) {
+    if(node == NULL)
+        return;
+    ((bench_allocator_t*)alloc_data)->dealloc_count++;
+}
+
+static void bench_allocator_rewind(bench_allocator_t* bump) {
+    bump->last = bump->first;
+    bump->first->current_node = bump->first->nodes;
+}
+
+static void bench_allocator_free(bench_allocator_t* bump) {
+    node_chunk_t* chunk_iter = bump->first;
+    while(chunk_iter) {
+        node_chunk_t* tmp = chunk_iter->next;
+        free(chunk_iter);
+        chunk_iter = tmp;
+    }
+}
+
+static inline unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+//
+// documents are slices of the corpus, each followed by a terminator
+//
+typedef struct {
+    const char** docs;
+    size_t*      doc_sizes;
+    size_t       num_docs;
+    size_t       total_bytes;
+    char*        buffer; // NDJSON only, copy of the corpus with lines terminated
+} corpus_t;
+
+static int corpus_load_ndjson(corpus_t* corpus, const char* data, size_t size) {
+    corpus->buffer = (char*)malloc(size + 1ul);
+    memcpy(corpus->buffer, data, size);
+    corpus->buffer[size] = '\0';
+
+    size_t cap = 64ul;
+    corpus->docs      = (const char**)malloc(cap * sizeof(const char*));
+    corpus->doc_sizes = (size_t*)malloc(cap * sizeof(size_t));
+    corpus->num_docs  = 0ul;
+    corpus->total_bytes = 0ul;
+
+    char* line = corpus->buffer;
+    while(*line) {
+        char* eol = strchr(line, '\n');
+        char* next = (eol == NULL) ? line + strlen(line) : eol + 1;
+        if(eol != NULL)
+            *eol = '\0';
+
+        size_t len = strlen(line);
+        if(len > 0ul) {
+            if(corpus->num_docs == cap) {
+                cap *= 2ul;
+                corpus->docs      = (const char**)realloc(corpus->docs, cap * sizeof(const char*));
+                corpus->doc_sizes = (size_t*)realloc(corpus->doc_sizes, cap * sizeof(size_t));
+            }
+            corpus->docs[corpus->num_docs]      = line;
+            corpus->doc_sizes[corpus->num_docs] = len;
+            corpus->num_docs++;
+            corpus->total_bytes += len;
+        }
+        line = next;
+    }
+    return corpus->num_docs > 0ul;
+}
+
+static void corpus_load_single(corpus_t* corpus, const char* data, size_t size) {
+    corpus->buffer    = NULL;
+    corpus->docs      = (const char**)malloc(sizeof(const char*));
+    corpus->doc_sizes = (size_t*)malloc(sizeof(size_t));
+    corpus->docs[0]      = data;
+    corpus->doc_sizes[0] = size;
+    corpus->num_docs     = 1ul;
+    corpus->total_bytes  = size;
+}
+
+static void corpus_free(corpus_t* corpus) {
+    free(corpus->docs);
+    free(corpus->doc_sizes);
+    free(corpus->buffer);
+}
+
+typedef struct {
+    unsigned long long ns;
+    size_t allocs;
+} phase_t;
+
+enum { 
+    phase_parse, phase_iterate, phase_convert, phase_delete, 
+    phase_cbor, phase_msgpack, phase_cbor_source, phase_msgpack_source, 
+    phase_cbor_decode, phase_msgpack_decode, 
+    phase_count 
+};
+
+static const char* phase_names[phase_count] = { 
+    "parse", "iterate", "convert", "delete", 
+    "cbor", "msgpack", "cbor-src", "mp-src", 
+    "cbor-dec", "mp-dec" 
+};
+
+typedef struct {
+    size_t num_iters;
+    size_t num_warmup;
+    int ndjson;
+    int block_alloc;
+    int reuse;
+    int binary;
+    JsonParserOptions_t parser;
+} bench_options_t;
+
+//
+// walks every node through the iterator API. returns number of nodes visited
+//
+static size_t iterate_value(JsonNode_t* node, const char* src, size_t* sink) {
+    size_t count = 1ul;
+
+    if(node->type == JsonNodeType_object) {
+        JsonObjIter_t iter;
+        JsonObjIter_init(&iter, node);
+        JsonNode_t* pair;
+        for(pair = JsonObjIter_current(&iter); pair != NULL; JsonObjIter_next(&iter), pair = JsonObjIter_current(&iter)) {
+            JsonString_t key;
+            JsonPair_key(pair, src, &key);
+            *sink += JsonString_size(&key);
+            count += 1ul + iterate_value(JsonPair_field(pair), src, sink);
+        }
+    } else if(node->type == JsonNodeType_array) {
+        JsonArrIter_t iter;
+        JsonArrIter_init(&iter, node);
+        JsonNode_t* item;
+        for(item = JsonArrIter_current(&iter); item != NULL; JsonArrIter_next(&iter), item = JsonArrIter_current(&iter))
+            count += 1ul + iterate_value(item, src, sink); // element and item
+    } else {
+        *sink += (size_t)node->type;
+    }
+
+    return count;
+}
+
+//
+// converts every number and copies out every string
+//
+static void convert_value(JsonNode_t* node, const char* src, char* scratch, double* sink) {
+    if(node->type == JsonNodeType_object) {
+        JsonObjIter_t iter;
+        JsonObjIter_init(&iter, node);
+        JsonNode_t* pair;
+        for(pair = JsonObjIter_current(&iter); pair != NULL; JsonObjIter_next(&iter), pair = JsonObjIter_current(&iter)) {
+            JsonString_t key;
+            JsonPair_key(pair, src, &key);
+            *sink += (double)JsonString_copy(&key, scratch);
+            convert_value(JsonPair_field(pair), src, scratch, sink);
+        }
+    } else if(node->type == JsonNodeType_array) {
+        JsonArrIter_t iter;
+        JsonArrIter_init(&iter, node);
+        JsonNode_t* item;
+        for(item = JsonArrIter_current(&iter); item != NULL; JsonArrIter_next(&iter), item = JsonArrIter_current(&iter))
+            convert_value(item, src, scratch, sink);
+    } else if(node->type == JsonNodeType_string) {
+        JsonString_t str;
+        JsonString_init(&str, src, node);
+        *sink += (double)JsonString_copy(&str, scratch);
+    } else if(node->type == JsonNodeType_number) {
+        JsonNumber_t n;
+        if(JsonNumber_convert_from_json_string(src, node, &n)) {
+            switch(n.type) {
+            case JsonNumberType_unsigned: *sink += (double)n.u; break;
+            case JsonNumberType_signed:   *sink += (double)n.s; break;
+            case JsonNumberType_real:     *sink += n.r;         break;
+            }
+        }
+    }
+}
+
+//
+// corpus file contents, mapped when mmap is available and read into 
+// the heap otherwise. data is null-terminated either way
+//
+typedef struct {
+    const char* data;
+    size_t size;
+#ifdef JSONPARSER_HAS_MMAP
+    JsonMappedFile_t mapped;
+#endif
+    char* buffer;
+} corpus_file_t;
+
+static int corpus_file_open(corpus_file_t* file, const char* filename) {
+    file->buffer = NULL;
+#ifdef JSONPARSER_HAS_MMAP
+    if(!JsonMappedFile_open(&file->mapped, filename))
+        return 0;
+    file->data = file->mapped.data;
+    file->size = file->mapped.size;
+    return 1;
+#else
+    FILE* fptr = fopen(filename, "rb");
+    if(fptr == NULL)
+        return 0;
+
+    fseek(fptr, 0L, SEEK_END);
+    const long l_size = ftell(fptr);
+    rewind(fptr);
+
+    if(l_size < 0L || (file->buffer = (char*)malloc((size_t)l_size + 1ul)) == NULL) {
+        fclose(fptr);
+        return 0;
+    }
+
+    file->size = fread(file->buffer, 1, (size_t)l_size, fptr);
+    fclose(fptr);
+    file->buffer[file->size] = '\0';
+    file->data = file->buffer;
+    return 1;
+#endif // JSONPARSER_HAS_MMAP
+}
+
+static void corpus_file_close(corpus_file_t* file) {
+#ifdef JSONPARSER_HAS_MMAP
+    JsonMappedFile_close(&file->mapped);
+#endif
+    free(file->buffer);
+}
+
+static int run_corpus(const char* filename, const bench_options_t* opts) {
+    const size_t num_iters  = opts->num_iters;
+    const size_t num_warmup = opts->num_warmup;
+
+    corpus_file_t file;
+    if(!corpus_file_open(&file, filename)) {
+        printf("%s : could not open\n", filename);
+        return 0;
+    }
+
+    corpus_t corpus;
+    if(opts->ndjson) {
+        if(!corpus_load_ndjson(&corpus, file.data, file.size)) {
+            printf("%s : no documents\n", filename);
+            corpus_file_close(&file);
+            return 0;
+        }
+    } else {
+        corpus_load_single(&corpus, file.data, file.size);
+    }
+
+    size_t max_doc = 0ul;
+    size_t d;
+    for(d = 0ul; d < corpus.num_docs; d++)
+        if(corpus.doc_sizes[d] > max_doc) max_doc = corpus.doc_sizes[d];
+    char* scratch = (char*)malloc(max_doc + 1ul);
+
+    // encodings outgrow the source only through short floats like 0.1
+    const size_t binary_cap = max_doc * 4ul + 64ul;
+    unsigned char* binary_out = opts->binary ? (unsigned char*)malloc(binary_cap) : NULL;
+    char* decode_buf = NULL;
+    size_t decode_cap = 0ul;
+
+    bench_allocator_t bump;
+    bump.first = new_node_chunk();
+    bump.last  = bump.first;
+
+    phase_t phases[phase_count];
+    memset(phases, 0, sizeof(phases));
+
+    //
+    // with reuse, one document lives for the whole run and keeps its nodes 
+    // between parses, so the allocator must not be rewound underneath it
+    //
+    JsonDocument_t doc;
+    JsonDocument_t decoded;
+    if(opts->block_alloc) {
+        JsonParser_init_document_block(&doc, NULL, bench_alloc_block, &bump);
+        JsonParser_init_document_block(&decoded, NULL, bench_alloc_block, &bump);
+    } else {
+        JsonParser_init_document(&doc, bench_dealloc, bench_alloc, &bump);
+        JsonParser_init_document(&decoded, bench_dealloc, bench_alloc, &bump);
+    }
+
+    size_t nodes_per_pass = 0ul;
+    size_t sink = 0ul;
+    double fsink = 0.0;
+
+    size_t iter;
+    for(iter = 0ul; iter < num_warmup + num_iters; iter++) {
+        const int measure = (iter >= num_warmup);
+        size_t pass_nodes  = 0ul;
+
+        for(d = 0ul; d < corpus.num_docs; d++) {
+            const char* src = corpus.docs[d];
+            if(!opts->reuse)
+                bench_allocator_rewind(&bump);
+            bump.alloc_count = 0ul;
+            bump.dealloc_count = 0ul;
+
+            unsigned long long t0 = now_ns();
+            JsonParseCode_t code = JsonParser_parse_document_options(&doc, src, &opts->parser);
+            unsigned long long t1 = now_ns();
+            const size_t allocs = bump.alloc_count;
+
+            if(code != JsonParseCode_success) {
+                printf("%s : document %lu failed to parse : %s (offset %lu)\n", 
+                        filename, d, JsonParseCode_as_string(code), doc.error_offset);
+                JsonParser_delete_document(&doc);
+                free(decode_buf);
+                free(binary_out);
+                free(scratch);
+                bench_allocator_free(&bump);
+                corpus_free(&corpus);
+                corpus_file_close(&file);
+                return 0;
+            }
+
+            pass_nodes += iterate_value(doc.first, src, &sink);
+            unsigned long long t2 = now_ns();
+
+            convert_value(doc.first, src, scratch, &fsink);
+            unsigned long long t3 = now_ns();
+
+            if(opts->binary && measure) {
+                static const int formats[2] = { JsonBinaryFormat_cbor, JsonBinaryFormat_msgpack };
+                int f;
+                for(f = 0; f < 2; f++) {
+                    JsonParseCode_t bcode;
+                    unsigned long long b0 = now_ns();
+                    sink += JsonBinary_encode_source((JsonBinaryFormat_t)formats[f], src, binary_out, binary_cap, &bcode);
+                    unsigned long long b1 = now_ns();
+                    const size_t encoded = JsonBinary_encode((JsonBinaryFormat_t)formats[f], src, doc.first, binary_out, binary_cap);
+                    unsigned long long b2 = now_ns();
+
+                    // the decoder writes the text of numbers after its input
+                    if(JSONBINARY_DECODE_BUFFER_SIZE(encoded) > decode_cap) {
+                        decode_cap = JSONBINARY_DECODE_BUFFER_SIZE(encoded);
+                        decode_buf = (char*)realloc(decode_buf, decode_cap);
+                    }
+                    memcpy(decode_buf, binary_out, encoded);
+
+                    unsigned long long b3 = now_ns();
+                    bcode = JsonBinary_decode((JsonBinaryFormat_t)formats[f], &decoded, decode_buf, encoded, decode_cap);
+                    unsigned long long b4 = now_ns();
+
+                    if(bcode != JsonParseCode_success)
+                        printf("%s : document %lu failed to decode : %s\n", filename, d, JsonParseCode_as_string(bcode));
+                    if(opts->reuse)
+                        JsonParser_reset_document(&decoded);
+                    else
+                        JsonParser_delete_document(&decoded);
+
+                    sink += encoded;
+                    phases[phase_cbor_source + f].ns += b1 - b0;
+                    phases[phase_cbor + f].ns        += b2 - b1;
+                    phases[phase_cbor_decode + f].ns += b4 - b3;
+                }
+            }
+            unsigned long long t3_binary = now_ns();
+
+            const size_t deallocs = bump.dealloc_count; // the decoded documents are not counted
+            if(opts->reuse)
+                JsonParser_reset_document(&doc);
+            else
+                JsonParser_delete_document(&doc);
+            unsigned long long t4 = now_ns();
+
+            if(measure) {
+                phases[phase_parse].ns   += t1 - t0;
+                phases[phase_iterate].ns += t2 - t1;
+                phases[phase_convert].ns += t3 - t2;
+                phases[phase_delete].ns  += t4 - t3_binary;
+                phases[phase_parse].allocs  += allocs;
+                phases[phase_delete].allocs += bump.dealloc_count - deallocs; // deallocations
+            }
+        }
+
+        nodes_per_pass = pass_nodes;
+    }
+
+    JsonParser_delete_document(&doc);
+    JsonParser_delete_document(&decoded);
+
+    printf("%s : %lu bytes, %lu document(s), %lu nodes, %lu iterations (+%lu warm-up)%s%s\n",
+            filename, corpus.total_bytes, corpus.num_docs, nodes_per_pass, num_iters, num_warmup, 
+            opts->block_alloc ? ", block allocation" : "", opts->reuse ? ", document reuse" : "");
+    printf("    %-8s %12s %14s %10s %12s\n", "phase", "MB/s", "docs/s", "ns/node", "allocs/doc");
+
+    int p;
+    for(p = 0; p < (opts->binary ? phase_count : phase_delete + 1); p++) {
+        const double seconds = (double)phases[p].ns / 1e9;
+        const double mbps    = seconds > 0.0 ? ((double)corpus.total_bytes * (double)num_iters / 1e6) / seconds : 0.0;
+        const double docsps  = seconds > 0.0 ? ((double)corpus.num_docs * (double)num_iters) / seconds : 0.0;
+        const double nspn    = nodes_per_pass > 0ul ? (double)phases[p].ns / ((double)nodes_per_pass * (double)num_iters) : 0.0;
+        const double apd     = (double)phases[p].allocs / ((double)corpus.num_docs * (double)num_iters);
+
+        printf("    %-8s %12.2f %14.1f %10.2f %12.2f\n", phase_names[p], mbps, docsps, nspn, apd);
+    }
+
+    // keep the compiler from discarding the iterate/convert phases
+    if(sink == 1ul && fsink == 1.0)
+        printf("\n");
+
+    free(decode_buf);
+    free(binary_out);
+    free(scratch);
+    bench_allocator_free(&bump);
+    corpus_free(&corpus);
+    corpus_file_close(&file);
+    return 1;
+}
+
+static void print_usage(void) {
+    printf("usage:\n    ./bench [-n <iterations>] [-w <warm-up iterations>] [--block] [--reset] [--binary] [--strict|--lenient] [--validate-utf8] [--json|--ndjson] <corpus> ...\n\n");
+    printf("    options apply to the corpora that follow them, -n must be at least 1\n");
+    printf("    --ndjson treats the corpora that follow as one document per line\n");
+    printf("    --block  hands nodes to the parser in blocks (JsonParser_init_document_block)\n");
+    printf("    --reset  parses every document into one JsonDocument_t with JsonParser_reset_document in between\n");
+    printf("    --binary also times encoding to and decoding from CBOR and MessagePack\n");
+    printf("    --strict, --lenient and --validate-utf8 override the parser defaults (JsonParserOptions_t)\n\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+
+    bench_options_t opts;
+    opts.num_iters   = 100ul;
+    opts.num_warmup  = 10ul;
+    opts.ndjson      = 0;
+    opts.block_alloc = 0;
+    opts.reuse       = 0;
+    opts.binary      = 0;
+    JsonParserOptions_init(&opts.parser);
+
+    //
+    // collect every corpus with the options in effect for it first, 
+    // so bad arguments are reported before anything is run
+    //
+    const char** corpora = (const char**)malloc((size_t)argc * sizeof(const char*));
+    bench_options_t* corpus_opts = (bench_options_t*)malloc((size_t)argc * sizeof(bench_options_t));
+    int num_corpora = 0;
+    int valid = 1;
+
+    int i;
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            opts.num_iters = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            opts.num_warmup = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--ndjson") == 0) {
+            opts.ndjson = 1;
+        } else if(strcmp(argv[i], "--json") == 0) {
+            opts.ndjson = 0;
+        } else if(strcmp(argv[i], "--block") == 0) {
+            opts.block_alloc = 1;
+        } else if(strcmp(argv[i], "--reset") == 0) {
+            opts.reuse = 1;
+        } else if(strcmp(argv[i], "--binary") == 0) {
+            opts.binary = 1;
+        } else if(strcmp(argv[i], "--strict") == 0) {
+            opts.parser.strict = 1;
+        } else if(strcmp(argv[i], "--lenient") == 0) {
+            opts.parser.strict = 0;
+        } else if(strcmp(argv[i], "--validate-utf8") == 0) {
+            opts.parser.validate_utf8 = 1;
+        } else {
+            if(opts.num_iters == 0ul)
+                valid = 0;
+            corpora[num_corpora]     = argv[i];
+            corpus_opts[num_corpora] = opts;
+            num_corpora++;
+        }
+    }
+
+    if(num_corpora == 0 || !valid) {
+        print_usage();
+        free(corpora);
+        free(corpus_opts);
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    for(i = 0; i < num_corpora; i++)
+        if(!run_corpus(corpora[i], &corpus_opts[i]))
+            failures++;
+
+    free(corpora);
+    free(corpus_opts);
+    return failures ? 1 : 0;
+}
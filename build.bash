@@ -1,7 +1,20 @@
 #!/bin/bash
 
 # optimized
-gcc -o main main.c json-parser.c json-parser-util.c -std=c11 -O2
+gcc -o main main.c json-parser.c json-parser-util.c json-parser-mmap.c -std=c11 -O2
+
+# benchmark harness and corpus generator (see bench.bash)
+gcc -o bench bench.c json-parser.c json-parser-util.c json-parser-mmap.c json-parser-binary.c -std=c11 -O2
+gcc -o gen-corpus gen-corpus.c -std=c11 -O2
+
+# concurrent read test, run ./test-threads (add -fsanitize=thread to check for races)
+gcc -o test-threads test-threads.c json-parser.c json-parser-util.c -std=c11 -O2 -pthread
+
+# document cache stress test, run ./test-cache (add -fsanitize=thread or -fsanitize=address)
+gcc -o test-cache test-cache.c json-parser.c json-parser-util.c json-parser-cache.c -std=c11 -O2 -pthread
+
+# modules no program above uses, compiled so they keep building
+gcc -c json-parser-columns.c json-parser-aggregate.c json-parser-edit.c json-parser-patch.c json-parser-diff.c -std=c11 -O2
 
 # valgrind build
 ##gcc -o main main.c json-parser.c -fPIE -lm -I. -std=c11 -O0 -DTRACE_ON_EXIT -g
@@ -0,0 +1,268 @@
+//
+// deterministic generator for synthetic JSON corpora
+//
+// produces documents of a chosen size with controllable nesting depth, 
+// array width, keys per object, string length, escape density and number 
+// mix so benchmarks can show how parsing and lookups scale. the same 
+// parameters and seed always produce the same bytes
+//
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned long long size;   // target output size in bytes
+    int depth;                 // nesting depth of each record
+    int width;                 // elements per array
+    int keys;                  // fields per object
+    int str_min;               // string length range (chars)
+    int str_max;
+    double escape_density;     // chance of each string char being an escape sequence
+    double unicode_density;    // chance of each string char being a multibyte UTF-8 char
+    int weight_string;         // scalar type mix
+    int weight_number;
+    int weight_literal;
+    int weight_int;            // number mix
+    int weight_real;
+    int weight_exp;
+    int ndjson;                // one record per line instead of one big array
+    unsigned long long seed;
+} gen_params_t;
+
+typedef struct {
+    FILE* out;
+    unsigned long long written;
+    unsigned long long rng;
+    const gen_params_t* params;
+} gen_t;
+
+//
+// xorshift64*
+//
+static inline unsigned long long gen_rand(gen_t* g) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 2685821657736338717ull;
+}
+
+static inline int gen_range(gen_t* g, int lo, int hi) {
+    if(hi <= lo) return lo;
+    return lo + (int)(gen_rand(g) % (unsigned long long)(hi - lo + 1));
+}
+
+static inline double gen_unit(gen_t* g) {
+    return (double)(gen_rand(g) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline void gen_write(gen_t* g, const char* s, size_t len) {
+    fwrite(s, 1, len, g->out);
+    g->written += len;
+}
+
+static inline void gen_puts(gen_t* g, const char* s) {
+    gen_write(g, s, strlen(s));
+}
+
+static void gen_string(gen_t* g) {
+    static const char* escapes[] = { "\\n", "\\t", "\\\"", "\\\\", "\\/", "\\u00e9", "\\ud83d\\ude00" };
+    static const char* unicode[] = { "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" };
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+    const gen_params_t* p = g->params;
+    const int len = gen_range(g, p->str_min, p->str_max);
+
+    gen_write(g, "\"", 1);
+    int i;
+    for(i = 0; i < len; i++) {
+        const double r = gen_unit(g);
+        if(r < p->escape_density) {
+            gen_puts(g, escapes[gen_rand(g) % (sizeof(escapes) / sizeof(escapes[0]))]);
+        } else if(r < p->escape_density + p->unicode_density) {
+            gen_puts(g, unicode[gen_rand(g) % (sizeof(unicode) / sizeof(unicode[0]))]);
+        } else {
+            gen_write(g, &alphabet[gen_rand(g) % (sizeof(alphabet) - 1)], 1);
+        }
+    }
+    gen_write(g, "\"", 1);
+}
+
+static void gen_number(gen_t* g) {
+    const gen_params_t* p = g->params;
+    char buf[64];
+    int r = gen_range(g, 1, p->weight_int + p->weight_real + p->weight_exp);
+
+    if(r <= p->weight_int) {
+        long long v = (long long)(gen_rand(g) >> gen_range(g, 1, 63));
+        if(gen_rand(g) & 1ull) v = -v;
+        snprintf(buf, sizeof(buf), "%lld", v);
+    } else if(r <= p->weight_int + p->weight_real) {
+        snprintf(buf, sizeof(buf), "%.*f", gen_range(g, 1, 9), (gen_unit(g) - 0.5) * 2e6);
+    } else {
+        snprintf(buf, sizeof(buf), "%.6e", (gen_unit(g) - 0.5) * 1e300 * gen_unit(g));
+    }
+    gen_puts(g, buf);
+}
+
+static void gen_scalar(gen_t* g) {
+    const gen_params_t* p = g->params;
+    int r = gen_range(g, 1, p->weight_string + p->weight_number + p->weight_literal);
+
+    if(r <= p->weight_string) {
+        gen_string(g);
+    } else if(r <= p->weight_string + p->weight_number) {
+        gen_number(g);
+    } else {
+        static const char* literals[] = { "true", "false", "null" };
+        gen_puts(g, literals[gen_rand(g) % 3ull]);
+    }
+}
+
+//
+// one child of every container nests further so record size 
+// grows linearly with depth, the other children are scalars
+//
+static void gen_value(gen_t* g, int depth) {
+    const gen_params_t* p = g->params;
+
+    if(depth <= 0) {
+        gen_scalar(g);
+        return;
+    }
+
+    int i;
+    if(gen_rand(g) & 1ull) {
+        const int nested = gen_range(g, 0, p->keys - 1);
+        gen_write(g, "{", 1);
+        for(i = 0; i < p->keys; i++) {
+            char key[32];
+            snprintf(key, sizeof(key), "%s\"key%d\":", i ? "," : "", i);
+            gen_puts(g, key);
+            if(i == nested) gen_value(g, depth - 1);
+            else            gen_scalar(g);
+        }
+        gen_write(g, "}", 1);
+    } else {
+        const int nested = gen_range(g, 0, p->width - 1);
+        gen_write(g, "[", 1);
+        for(i = 0; i < p->width; i++) {
+            if(i) gen_write(g, ",", 1);
+            if(i == nested) gen_value(g, depth - 1);
+            else            gen_scalar(g);
+        }
+        gen_write(g, "]", 1);
+    }
+}
+
+static unsigned long long parse_size(const char* s) {
+    char* end;
+    unsigned long long v = strtoull(s, &end, 10);
+    switch(*end) {
+    case 'k': case 'K': v <<= 10; break;
+    case 'm': case 'M': v <<= 20; break;
+    case 'g': case 'G': v <<= 30; break;
+    default: break;
+    }
+    return v;
+}
+
+static void usage(void) {
+    printf("usage:\n    ./gen-corpus [options] > corpus.json\n\n");
+    printf("    -s <size>          target size, accepts K/M/G suffixes (default 1M)\n");
+    printf("    -d <depth>         nesting depth of each record (default 3)\n");
+    printf("    -w <width>         elements per array (default 4)\n");
+    printf("    -k <keys>          fields per object (default 4)\n");
+    printf("    -l <min>:<max>     string length range (default 4:16)\n");
+    printf("    -e <density>       fraction of string chars that are escapes (default 0)\n");
+    printf("    -u <density>       fraction of string chars that are multibyte UTF-8 (default 0)\n");
+    printf("    -t <s>:<n>:<l>     weights of strings, numbers and true/false/null (default 4:5:1)\n");
+    printf("    -m <i>:<r>:<e>     weights of integers, reals and exponents (default 5:4:1)\n");
+    printf("    --ndjson           emit one record per line instead of a single array\n");
+    printf("    --seed <n>         seed for the generator (default 1)\n\n");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+
+    gen_params_t p;
+    p.size = 1ull << 20;
+    p.depth = 3;
+    p.width = 4;
+    p.keys  = 4;
+    p.str_min = 4;
+    p.str_max = 16;
+    p.escape_density  = 0.0;
+    p.unicode_density = 0.0;
+    p.weight_string  = 4;
+    p.weight_number  = 5;
+    p.weight_literal = 1;
+    p.weight_int  = 5;
+    p.weight_real = 4;
+    p.weight_exp  = 1;
+    p.ndjson = 0;
+    p.seed = 1ull;
+
+    int i;
+    for(i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(strcmp(arg, "--ndjson") == 0) {
+            p.ndjson = 1;
+            continue;
+        }
+
+        if(val == NULL) {
+            usage();
+            return 1;
+        }
+        i++;
+
+        if(strcmp(arg, "-s") == 0)          p.size = parse_size(val);
+        else if(strcmp(arg, "-d") == 0)     p.depth = atoi(val);
+        else if(strcmp(arg, "-w") == 0)     p.width = atoi(val);
+        else if(strcmp(arg, "-k") == 0)     p.keys = atoi(val);
+        else if(strcmp(arg, "-l") == 0)     sscanf(val, "%d:%d", &p.str_min, &p.str_max);
+        else if(strcmp(arg, "-e") == 0)     p.escape_density = atof(val);
+        else if(strcmp(arg, "-u") == 0)     p.unicode_density = atof(val);
+        else if(strcmp(arg, "-t") == 0)     sscanf(val, "%d:%d:%d", &p.weight_string, &p.weight_number, &p.weight_literal);
+        else if(strcmp(arg, "-m") == 0)     sscanf(val, "%d:%d:%d", &p.weight_int, &p.weight_real, &p.weight_exp);
+        else if(strcmp(arg, "--seed") == 0) p.seed = strtoull(val, NULL, 10);
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if(p.weight_string + p.weight_number + p.weight_literal <= 0 || p.weight_int + p.weight_real + p.weight_exp <= 0) {
+        usage();
+        return 1;
+    }
+
+    gen_t g;
+    g.out = stdout;
+    g.written = 0ull;
+    g.rng = p.seed * 0x9E3779B97F4A7C15ull + 1ull; // never zero
+    g.params = &p;
+
+    if(p.ndjson) {
+        while(g.written < p.size) {
+            gen_value(&g, p.depth > 0 ? p.depth : 1);
+            gen_write(&g, "\n", 1);
+        }
+    } else {
+        gen_write(&g, "[", 1);
+        int first = 1;
+        while(g.written < p.size) {
+            if(!first) gen_write(&g, ",\n", 2);
+            first = 0;
+            gen_value(&g, p.depth);
+        }
+        gen_write(&g, "]\n", 2);
+    }
+
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,299 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-aggregate.h"
+#include "json-parser-util.h"
+
+#include <string.h>
+
+typedef enum {
+    JsonPathSegment_end       = 0,
+    JsonPathSegment_key       = 1,
+    JsonPathSegment_any_key   = 2,
+    JsonPathSegment_index     = 3,
+    JsonPathSegment_any_index = 4,
+    JsonPathSegment_invalid   = 5,
+} JsonPathSegmentKind_t;
+
+typedef struct {
+    JsonPathSegmentKind_t kind;
+    const char* name; // for JsonPathSegment_key
+    size_t name_len;
+    unsigned long index; // for JsonPathSegment_index
+} JsonPathSegment_t;
+
+//
+// reads the first segment of path. returns the rest of the path
+//
+static const char* JsonAggregate_segment(const char* path, JsonPathSegment_t* seg) {
+    seg->kind = JsonPathSegment_invalid;
+
+    if(*path == '\0') {
+        seg->kind = JsonPathSegment_end;
+        return path;
+    }
+
+    if(*path == '[') {
+        path++;
+        if(path[0] == '*' && path[1] == ']') {
+            seg->kind = JsonPathSegment_any_index;
+            return path + 2;
+        }
+
+        if(*path < '0' || *path > '9')
+            return path;
+
+        unsigned long index = 0ul;
+        while(*path >= '0' && *path <= '9') {
+            if(index > (~0ul - 9ul) / 10ul)
+                return path;
+            index = index * 10ul + (unsigned long)(*path - '0');
+            path++;
+        }
+
+        if(*path != ']')
+            return path;
+
+        seg->kind  = JsonPathSegment_index;
+        seg->index = index;
+        return path + 1;
+    }
+
+    if(*path == '.')
+        path++;
+
+    const char* name = path;
+    while(*path != '\0' && *path != '.' && *path != '[')
+        path++;
+
+    if(path == name)
+        return path;
+
+    if(path - name == 1 && *name == '*') {
+        seg->kind = JsonPathSegment_any_key;
+    } else {
+        seg->kind     = JsonPathSegment_key;
+        seg->name     = name;
+        seg->name_len = (size_t)(path - name);
+    }
+    return path;
+}
+
+int JsonAggregate_init(
+        JsonAggregate_t* agg,
+        const char* path,
+        unsigned long long* bins,
+        size_t num_bins,
+        double hist_min,
+        double hist_max) {
+
+    if(path == NULL)
+        return 0;
+
+    const char* iter = path;
+    for(;;) {
+        JsonPathSegment_t seg;
+        iter = JsonAggregate_segment(iter, &seg);
+        if(seg.kind == JsonPathSegment_invalid) return 0;
+        if(seg.kind == JsonPathSegment_end)     break;
+    }
+
+    if(bins == NULL)
+        num_bins = 0ul;
+    if(num_bins > 0ul && !(hist_min < hist_max))
+        return 0;
+
+    agg->path   = path;
+    agg->count  = 0ull;
+    agg->others = 0ull;
+    agg->sum    = 0.0;
+    agg->min    = 0.0;
+    agg->max    = 0.0;
+
+    agg->bins      = bins;
+    agg->num_bins  = num_bins;
+    agg->hist_min  = hist_min;
+    agg->hist_max  = hist_max;
+    agg->underflow = 0ull;
+    agg->overflow  = 0ull;
+
+    size_t i;
+    for(i = 0ul; i < num_bins; i++)
+        bins[i] = 0ull;
+
+    return 1;
+}
+
+double JsonAggregate_mean(const JsonAggregate_t* agg) {
+    return agg->count ? agg->sum / (double)agg->count : 0.0;
+}
+
+static void JsonAggregate_add(JsonAggregate_t* agg, const double d) {
+    if(agg->count == 0ull) {
+        agg->min = d;
+        agg->max = d;
+    } else {
+        if(d < agg->min) agg->min = d;
+        if(d > agg->max) agg->max = d;
+    }
+    agg->count++;
+    agg->sum += d;
+
+    if(agg->num_bins == 0ul)
+        return;
+
+    if(d < agg->hist_min) {
+        agg->underflow++;
+    } else if(d >= agg->hist_max) {
+        agg->overflow++;
+    } else {
+        size_t bin = (size_t)((d - agg->hist_min) / (agg->hist_max - agg->hist_min) * (double)agg->num_bins);
+        if(bin >= agg->num_bins) bin = agg->num_bins - 1ul; // rounding just below hist_max
+        agg->bins[bin]++;
+    }
+}
+
+//
+// str points at a value (past any whitespace) and path at the segments that 
+// are left to match inside of it. recursion only follows the path, everything 
+// else is skipped without a stack. returns the location just past the value
+//
+static const char* JsonAggregate_value(JsonAggregate_t* agg, const char* path, const char* str, JsonParseCode_t* code) {
+    JsonPathSegment_t seg;
+    const char* rest = JsonAggregate_segment(path, &seg);
+    const char c = *str;
+
+    if(seg.kind == JsonPathSegment_end) {
+        if(c != '-' && (c < '0' || c > '9')) {
+            agg->others++;
+            return JsonParser_skip_value(str, code);
+        }
+
+        const char* num_end = JsonParser_scan_number(str, code);
+        if(num_end == NULL) return NULL;
+
+        // a stand-in node based at the number itself, so offsets stay 
+        // small however large the source is
+        JsonNode_t num;
+        num.type      = JsonNodeType_number;
+        num.flags     = 0u;
+        num.num.start = 0;
+        num.num.end   = (JsonOffset_t)(num_end - str);
+
+        double d;
+        if(num_end - str < JSONPARSER_MAX_NUM_LEN && JsonNumber_to_double(str, &num, &d))
+            JsonAggregate_add(agg, d);
+        else
+            agg->others++;
+        return num_end;
+    }
+
+    const int keyed = (seg.kind == JsonPathSegment_key || seg.kind == JsonPathSegment_any_key);
+
+    if(keyed && c == '{') {
+        str = JsonParser_skip_whitespace(str + 1);
+
+        while(*str != '}') {
+            if(*str != '"') {
+                *code = JsonParseCode_malformed_object;
+                return NULL;
+            }
+
+            unsigned int flags;
+            const char* key_end = JsonParser_scan_string(str, &flags, code);
+            if(key_end == NULL) return NULL;
+
+            const int match = 
+                    seg.kind == JsonPathSegment_any_key || 
+                    ((size_t)(key_end - str - 1) == seg.name_len && memcmp(str + 1, seg.name, seg.name_len) == 0);
+
+            str = JsonParser_skip_whitespace(key_end + 1);
+            if(*str != ':') {
+                *code = JsonParseCode_malformed_object;
+                return NULL;
+            }
+            str = JsonParser_skip_whitespace(str + 1);
+
+            str = match ? JsonAggregate_value(agg, rest, str, code) : JsonParser_skip_value(str, code);
+            if(str == NULL) return NULL;
+
+            str = JsonParser_skip_whitespace(str);
+            if(*str == ',') {
+                str = JsonParser_skip_whitespace(str + 1);
+                if(*str == '}') {
+#ifdef JSONPARSER_NOT_STRICT
+                    break; // trailing comma
+#else
+                    *code = JsonParseCode_invalid_object_ending;
+                    return NULL;
+#endif // JSONPARSER_NOT_STRICT
+                }
+            } else if(*str != '}') {
+                *code = JsonParseCode_malformed_object;
+                return NULL;
+            }
+        }
+        return str + 1;
+    }
+
+    if(!keyed && c == '[') {
+        unsigned long index = 0ul;
+        str = JsonParser_skip_whitespace(str + 1);
+
+        while(*str != ']') {
+            const int match = (seg.kind == JsonPathSegment_any_index || seg.index == index);
+            str = match ? JsonAggregate_value(agg, rest, str, code) : JsonParser_skip_value(str, code);
+            if(str == NULL) return NULL;
+            index++;
+
+            str = JsonParser_skip_whitespace(str);
+            if(*str == ',') {
+                str = JsonParser_skip_whitespace(str + 1);
+                if(*str == ']') {
+#ifdef JSONPARSER_NOT_STRICT
+                    break; // trailing comma
+#else
+                    *code = JsonParseCode_invalid_array_ending;
+                    return NULL;
+#endif // JSONPARSER_NOT_STRICT
+                }
+            } else if(*str != ']') {
+                *code = JsonParseCode_malformed_array;
+                return NULL;
+            }
+        }
+        return str + 1;
+    }
+
+    return JsonParser_skip_value(str, code);
+}
+
+JsonParseCode_t JsonAggregate_source(JsonAggregate_t* agg, const char* source) {
+    if(source == NULL)
+        return JsonParseCode_empty_source;
+
+    const char* str = JsonParser_skip_whitespace(source);
+    if(*str == '\0')
+        return JsonParseCode_empty_source;
+
+    while(*str != '\0') {
+        JsonParseCode_t code = JsonParseCode_success;
+        str = JsonAggregate_value(agg, agg->path, str, &code);
+        if(str == NULL)
+            return code;
+        str = JsonParser_skip_whitespace(str);
+    }
+
+    return JsonParseCode_success;
+}
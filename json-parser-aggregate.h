@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// streaming aggregation of the numbers found at a path. the JSON text is 
+// scanned once with the parser's scanners and no nodes are allocated, 
+// so documents far larger than memory (see JsonMappedFile_open) can be 
+// folded down to a few statistics.
+//
+// a path is a sequence of segments, each selecting children of the value 
+// selected so far:
+//   .name or name   field of an object (compared with the raw, escaped key)
+//   .*              every field of an object
+//   [N]             element N of an array
+//   [*]             every element of an array
+// for example "[*].latency_ms" or "rows[*].stats.*". the empty path 
+// selects the root value itself. values that do not have the shape the 
+// path expects are skipped
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+
+typedef struct JsonAggregate {
+    const char* path;
+
+    unsigned long long count;  // numbers matched
+    unsigned long long others; // matched values that are not numbers
+    double sum;
+    double min;                // min and max are only valid if count > 0
+    double max;
+
+    // optional histogram of num_bins equal-width bins over [hist_min, hist_max).
+    // numbers outside of that range are counted in underflow and overflow
+    unsigned long long* bins;
+    size_t num_bins;
+    double hist_min;
+    double hist_max;
+    unsigned long long underflow;
+    unsigned long long overflow;
+} JsonAggregate_t;
+
+//
+// prepare agg for the given path, which must outlive agg. bins may be NULL 
+// with num_bins 0 for no histogram, otherwise the bins are zeroed.
+// returns 1 on success, else 0 if the path is malformed or the histogram range is empty
+//
+int JsonAggregate_init(
+        JsonAggregate_t* agg,
+        const char* path,
+        unsigned long long* bins,
+        size_t num_bins,
+        double hist_min,
+        double hist_max);
+
+//
+// add every number at the path in null-terminated JSON text to agg. the 
+// source may hold several root values one after another (such as NDJSON), 
+// and the path is applied to each. agg keeps accumulating across calls.
+// values off the path are skipped with JsonParser_skip_value, which only 
+// checks their brackets balance.
+// on failure, numbers before the error have already been added
+//
+JsonParseCode_t JsonAggregate_source(JsonAggregate_t* agg, const char* source);
+
+//
+// mean of the numbers matched so far, 0 if there are none
+//
+double JsonAggregate_mean(const JsonAggregate_t* agg);
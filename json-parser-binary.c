@@ -0,0 +1,1039 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-binary.h"
+#include "json-parser-util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+
+//
+// output position keeps counting past the end of dest so
+// the full size of the encoding is always known
+//
+typedef struct {
+    unsigned char* dest;
+    size_t dest_len;
+    size_t pos;
+    JsonBinaryFormat_t format;
+} JsonBinary_writer_t;
+
+static inline int JsonBinary_fits(const JsonBinary_writer_t* w, size_t n) {
+    return w->pos <= w->dest_len && n <= w->dest_len - w->pos;
+}
+
+static inline void JsonBinary_put(JsonBinary_writer_t* w, unsigned char b) {
+    if(w->pos < w->dest_len)
+        w->dest[w->pos] = b;
+    w->pos++;
+}
+
+static inline void JsonBinary_put_be(JsonBinary_writer_t* w, uint64_t v, int bytes) {
+    while(bytes-- > 0)
+        JsonBinary_put(w, (unsigned char)(v >> (8 * bytes)));
+}
+
+//
+// CBOR initial byte and argument
+//
+static void JsonBinary_cbor_head(JsonBinary_writer_t* w, unsigned char major, uint64_t v) {
+    major = (unsigned char)(major << 5);
+
+    if(v < 24u) {
+        JsonBinary_put(w, (unsigned char)(major | v));
+    } else if(v <= 0xffu) {
+        JsonBinary_put(w, major | 24u);
+        JsonBinary_put_be(w, v, 1);
+    } else if(v <= 0xffffu) {
+        JsonBinary_put(w, major | 25u);
+        JsonBinary_put_be(w, v, 2);
+    } else if(v <= 0xffffffffu) {
+        JsonBinary_put(w, major | 26u);
+        JsonBinary_put_be(w, v, 4);
+    } else {
+        JsonBinary_put(w, major | 27u);
+        JsonBinary_put_be(w, v, 8);
+    }
+}
+
+static void JsonBinary_msgpack_uint(JsonBinary_writer_t* w, uint64_t v) {
+    if(v < 0x80u) {
+        JsonBinary_put(w, (unsigned char)v); // positive fixint
+    } else if(v <= 0xffu) {
+        JsonBinary_put(w, 0xcc);
+        JsonBinary_put_be(w, v, 1);
+    } else if(v <= 0xffffu) {
+        JsonBinary_put(w, 0xcd);
+        JsonBinary_put_be(w, v, 2);
+    } else if(v <= 0xffffffffu) {
+        JsonBinary_put(w, 0xce);
+        JsonBinary_put_be(w, v, 4);
+    } else {
+        JsonBinary_put(w, 0xcf);
+        JsonBinary_put_be(w, v, 8);
+    }
+}
+
+static void JsonBinary_msgpack_negative(JsonBinary_writer_t* w, int64_t v) {
+    if(v >= -32) {
+        JsonBinary_put(w, (unsigned char)(v & 0xff)); // negative fixint
+    } else if(v >= INT8_MIN) {
+        JsonBinary_put(w, 0xd0);
+        JsonBinary_put_be(w, (uint64_t)v, 1);
+    } else if(v >= INT16_MIN) {
+        JsonBinary_put(w, 0xd1);
+        JsonBinary_put_be(w, (uint64_t)v, 2);
+    } else if(v >= INT32_MIN) {
+        JsonBinary_put(w, 0xd2);
+        JsonBinary_put_be(w, (uint64_t)v, 4);
+    } else {
+        JsonBinary_put(w, 0xd3);
+        JsonBinary_put_be(w, (uint64_t)v, 8);
+    }
+}
+
+//
+// reads an integer written without fraction or exponent. value is its 
+// magnitude, or the magnitude minus one for a negative number as CBOR 
+// stores it, so everything from -2^64 to 2^64-1 fits. "-0" is read as 0.
+// returns 0 if there are no digits or the value does not fit
+//
+static int JsonBinary_scan_integer(const char* start, const char* end, int* negative, uint64_t* value) {
+    *negative = (start < end && *start == '-');
+    if(*negative)
+        start++;
+    if(start == end)
+        return 0;
+
+    uint64_t v = 0u;
+    for(; start < end - 1; start++) {
+        const unsigned d = (unsigned)(*start - '0');
+        if(d > 9u || v > (UINT64_MAX - d) / 10u)
+            return 0;
+        v = v * 10u + d;
+    }
+
+    unsigned d = (unsigned)(*start - '0');
+    if(d > 9u)
+        return 0;
+    if(*negative) {
+        if(d == 0u) {
+            if(v == 0u) { // -0
+                *negative = 0;
+                *value = 0u;
+                return 1;
+            }
+            v--; // -(10v) = -(10(v-1) + 9) - 1
+            d = 10u;
+        }
+        d--;
+    }
+    if(v > (UINT64_MAX - d) / 10u)
+        return 0;
+    *value = v * 10u + d;
+    return 1;
+}
+
+//
+// integers from -2^64 to 2^64-1 keep their exact value, except below 
+// -2^63 in MessagePack, which has no encoding for them. fractions, 
+// exponents and integers out of range are written as floating point,
+// as a float when that is exact and as a double otherwise.
+// returns 0 if the number can not be converted
+//
+static int JsonBinary_put_number(JsonBinary_writer_t* w, const char* doc_source, const JsonNode_t* num_node) {
+    const int cbor = (w->format == JsonBinaryFormat_cbor);
+
+    const char* start = doc_source + num_node->num.start;
+    const char* end   = doc_source + num_node->num.end;
+    int integral = 1;
+    const char* p;
+    for(p = start; p < end; p++)
+        if(*p == '.' || *p == 'e' || *p == 'E')
+            integral = 0;
+
+    int negative;
+    uint64_t u;
+    if(integral && JsonBinary_scan_integer(start, end, &negative, &u)) {
+        if(!negative) {
+            if(cbor) JsonBinary_cbor_head(w, 0, u);
+            else     JsonBinary_msgpack_uint(w, u);
+            return 1;
+        }
+        if(cbor) {
+            JsonBinary_cbor_head(w, 1, u);
+            return 1;
+        }
+        if(u <= (uint64_t)INT64_MAX) {
+            JsonBinary_msgpack_negative(w, -(int64_t)u - 1);
+            return 1;
+        }
+    }
+
+    double r;
+    if(!JsonNumber_to_double(doc_source, num_node, &r))
+        return 0;
+
+    const float f = (float)r;
+    if((double)f == r) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        JsonBinary_put(w, cbor ? 0xfa : 0xca);
+        JsonBinary_put_be(w, bits, 4);
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &r, sizeof(bits));
+        JsonBinary_put(w, cbor ? 0xfb : 0xcb);
+        JsonBinary_put_be(w, bits, 8);
+    }
+    return 1;
+}
+
+static void JsonBinary_put_literal(JsonBinary_writer_t* w, JsonNodeType_t type) {
+    const int cbor = (w->format == JsonBinaryFormat_cbor);
+
+    switch(type) {
+    case JsonNodeType_true:  JsonBinary_put(w, cbor ? 0xf5 : 0xc3); break;
+    case JsonNodeType_false: JsonBinary_put(w, cbor ? 0xf4 : 0xc2); break;
+    default:                 JsonBinary_put(w, cbor ? 0xf6 : 0xc0); break;
+    }
+}
+
+//
+// count is ignored for the indefinite-length/32-bit container starts used
+// by JsonBinary_encode_source, their entries are filled in when they close
+//
+static void JsonBinary_put_container_head(JsonBinary_writer_t* w, size_t count, int is_object) {
+    if(w->format == JsonBinaryFormat_cbor) {
+        JsonBinary_cbor_head(w, is_object ? 5 : 4, (uint64_t)count);
+    } else if(count < 16ul) {
+        JsonBinary_put(w, (unsigned char)((is_object ? 0x80 : 0x90) | count));
+    } else if(count <= 0xfffful) {
+        JsonBinary_put(w, is_object ? 0xde : 0xdc);
+        JsonBinary_put_be(w, (uint64_t)count, 2);
+    } else {
+        JsonBinary_put(w, is_object ? 0xdf : 0xdd);
+        JsonBinary_put_be(w, (uint64_t)count, 4);
+    }
+}
+
+//
+// size of a string once its escape sequences are decoded
+//
+static size_t JsonBinary_unescaped_size(const char* start, const char* end) {
+    size_t len = 0ul;
+    char tmp[8];
+
+    while(start < end) {
+        const char* esc = (const char*)memchr(start, '\\', (size_t)(end - start));
+        if(esc == NULL) {
+            len += (size_t)(end - start);
+            break;
+        }
+
+        len += (size_t)(esc - start);
+
+        size_t n = 0ul;
+        start = JsonParser_decode_escape(esc, end, tmp, &n);
+        len += n;
+    }
+
+    return len;
+}
+
+static void JsonBinary_put_string(JsonBinary_writer_t* w, const JsonString_t* str) {
+    const char* start = str->doc_source + str->start;
+    const char* end   = str->doc_source + str->end;
+
+    const size_t len = (str->flags & JsonNodeFlag_escaped) ?
+            JsonBinary_unescaped_size(start, end) : (size_t)(end - start);
+
+    if(w->format == JsonBinaryFormat_cbor) {
+        JsonBinary_cbor_head(w, 3, (uint64_t)len);
+    } else if(len < 32ul) {
+        JsonBinary_put(w, (unsigned char)(0xa0 | len)); // fixstr
+    } else if(len <= 0xfful) {
+        JsonBinary_put(w, 0xd9);
+        JsonBinary_put_be(w, (uint64_t)len, 1);
+    } else if(len <= 0xfffful) {
+        JsonBinary_put(w, 0xda);
+        JsonBinary_put_be(w, (uint64_t)len, 2);
+    } else {
+        JsonBinary_put(w, 0xdb);
+        JsonBinary_put_be(w, (uint64_t)len, 4);
+    }
+
+    if(w->dest != NULL && JsonBinary_fits(w, len))
+        (void)JsonString_copy_utf8(str, (char*)w->dest + w->pos);
+    w->pos += len;
+}
+
+//
+// recursion is bounded by JSONPARSER_MAX_DEPTH, neither the parser
+// nor the editing functions build deeper trees
+//
+static int JsonBinary_encode_node(JsonBinary_writer_t* w, const char* doc_source, const JsonNode_t* node) {
+    switch(node->type) {
+    case JsonNodeType_object: {
+        size_t count = 0ul;
+        const JsonNode_t* pair;
+        for(pair = node->obj.first; pair != NULL; pair = pair->pair.next)
+            count++;
+
+        JsonBinary_put_container_head(w, count, 1);
+
+        for(pair = node->obj.first; pair != NULL; pair = pair->pair.next) {
+            JsonString_t key;
+            if(!JsonPair_key(pair, doc_source, &key) || pair->pair.value == NULL)
+                return 0;
+
+            JsonBinary_put_string(w, &key);
+            if(!JsonBinary_encode_node(w, doc_source, pair->pair.value))
+                return 0;
+        }
+        return 1;
+    }
+
+    case JsonNodeType_array: {
+        size_t count = 0ul;
+        const JsonNode_t* elem;
+        for(elem = node->arr.first; elem != NULL; elem = elem->elem.next)
+            count++;
+
+        JsonBinary_put_container_head(w, count, 0);
+
+        for(elem = node->arr.first; elem != NULL; elem = elem->elem.next) {
+            if(elem->elem.item == NULL || !JsonBinary_encode_node(w, doc_source, elem->elem.item))
+                return 0;
+        }
+        return 1;
+    }
+
+    case JsonNodeType_string: {
+        JsonString_t str;
+        if(!JsonString_init(&str, doc_source, node))
+            return 0;
+        JsonBinary_put_string(w, &str);
+        return 1;
+    }
+
+    case JsonNodeType_number:
+        return JsonBinary_put_number(w, doc_source, node);
+
+    case JsonNodeType_true:
+    case JsonNodeType_false:
+    case JsonNodeType_null:
+        JsonBinary_put_literal(w, node->type);
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+size_t JsonBinary_encode(
+        JsonBinaryFormat_t format,
+        const char* doc_source,
+        const JsonNode_t* node,
+        unsigned char* dest,
+        size_t dest_len) {
+
+    if(doc_source == NULL || node == NULL)
+        return 0ul;
+
+    JsonBinary_writer_t w;
+    w.dest     = dest;
+    w.dest_len = (dest != NULL ? dest_len : 0ul);
+    w.pos      = 0ul;
+    w.format   = format;
+
+    if(!JsonBinary_encode_node(&w, doc_source, node))
+        return 0ul;
+    return w.pos;
+}
+
+//
+// string, number or literal at str. returns the position after it.
+// kept out of JsonBinary_encode_source_container so the frames it 
+// stacks up stay small
+//
+static const char* JsonBinary_encode_source_scalar(JsonBinary_writer_t* w, const char* str, int in_object, JsonParseCode_t* code) {
+    const char c = *str;
+
+    if(c == '"') {
+        JsonString_t s;
+        s.doc_source = str + 1;
+        s.start = 0;
+
+        const char* end = JsonParser_scan_string(str, &s.flags, code);
+        if(end == NULL)
+            return NULL;
+
+        s.end = (JsonOffset_t)(end - (str + 1));
+        JsonBinary_put_string(w, &s);
+        return end + 1;
+    }
+
+    if(c == '-' || (c >= '0' && c <= '9')) {
+        const char* end = JsonParser_scan_number(str, code);
+        if(end == NULL)
+            return NULL;
+
+        JsonNode_t num_node;
+        num_node.type = JsonNodeType_number;
+        num_node.flags = 0u;
+        num_node.num.start = 0;
+        num_node.num.end   = (JsonOffset_t)(end - str);
+
+        if(!JsonBinary_put_number(w, str, &num_node)) {
+            *code = JsonParseCode_number_invalid_char;
+            return NULL;
+        }
+        return end;
+    }
+
+    if(strncmp(str, "true", 4) == 0) {
+        JsonBinary_put_literal(w, JsonNodeType_true);
+        return str + 4;
+    } else if(strncmp(str, "false", 5) == 0) {
+        JsonBinary_put_literal(w, JsonNodeType_false);
+        return str + 5;
+    } else if(strncmp(str, "null", 4) == 0) {
+        JsonBinary_put_literal(w, JsonNodeType_null);
+        return str + 4;
+    }
+
+    *code = in_object ? JsonParseCode_malformed_object : JsonParseCode_malformed_array;
+    return NULL;
+}
+
+//
+// container whose opening bracket is at str, depth counts it. the number 
+// of entries is not known up front, so CBOR uses an indefinite length and 
+// non-empty MessagePack containers an array32/map32 header that gets its 
+// count once the container closes. each open container has its own frame, 
+// so the stack grows with the nesting of the source and recursion is 
+// bounded by JSONPARSER_MAX_DEPTH like in JsonBinary_encode_node.
+// returns the position after the closing bracket
+//
+static const char* JsonBinary_encode_source_container(JsonBinary_writer_t* w, const char* str, unsigned long depth, JsonParseCode_t* code) {
+    const int is_object = (*str == '{');
+    const char close = is_object ? '}' : ']';
+
+    str = JsonParser_skip_whitespace(str + 1);
+    if(*str == close) {
+        JsonBinary_put_container_head(w, 0ul, is_object);
+        return str + 1;
+    }
+
+    if(depth > JSONPARSER_MAX_DEPTH) {
+        *code = JsonParseCode_stack_error;
+        return NULL;
+    }
+
+    const size_t header = w->pos;
+    if(w->format == JsonBinaryFormat_cbor) {
+        JsonBinary_put(w, is_object ? 0xbf : 0x9f);
+    } else {
+        JsonBinary_put(w, is_object ? 0xdf : 0xdd);
+        JsonBinary_put_be(w, 0u, 4);
+    }
+
+    unsigned long count = 0ul;
+    for(;;) {
+        if(is_object) {
+            if(*str != '"') {
+                *code = JsonParseCode_malformed_object;
+                return NULL;
+            }
+            str = JsonBinary_encode_source_scalar(w, str, is_object, code);
+            if(str == NULL)
+                return NULL;
+
+            str = JsonParser_skip_whitespace(str);
+            if(*str != ':') {
+                *code = JsonParseCode_malformed_object;
+                return NULL;
+            }
+            str = JsonParser_skip_whitespace(str + 1);
+        }
+
+        if(*str == '{' || *str == '[')
+            str = JsonBinary_encode_source_container(w, str, depth + 1ul, code);
+        else
+            str = JsonBinary_encode_source_scalar(w, str, is_object, code);
+        if(str == NULL)
+            return NULL;
+        count++;
+
+        str = JsonParser_skip_whitespace(str);
+        if(*str == ',') {
+            const char* next = JsonParser_skip_whitespace(str + 1);
+            if(*next != close) {
+                str = next;
+                continue;
+            }
+#ifdef JSONPARSER_NOT_STRICT
+            str = next; // trailing comma
+#else
+            *code = is_object ? JsonParseCode_invalid_object_ending : JsonParseCode_invalid_array_ending;
+            return NULL;
+#endif // JSONPARSER_NOT_STRICT
+        } else if(*str != close) {
+            *code = is_object ? JsonParseCode_malformed_object : JsonParseCode_malformed_array;
+            return NULL;
+        }
+        break;
+    }
+
+    if(w->format == JsonBinaryFormat_cbor) {
+        JsonBinary_put(w, 0xff);
+    } else if(header + 5ul <= w->dest_len) {
+        const size_t save = w->pos;
+        w->pos = header + 1ul;
+        JsonBinary_put_be(w, (uint64_t)count, 4);
+        w->pos = save;
+    }
+    return str + 1;
+}
+
+size_t JsonBinary_encode_source(
+        JsonBinaryFormat_t format,
+        const char* source,
+        unsigned char* dest,
+        size_t dest_len,
+        JsonParseCode_t* code) {
+
+    JsonParseCode_t unused_code;
+    if(code == NULL)
+        code = &unused_code;
+
+    if(source == NULL) {
+        *code = JsonParseCode_empty_source;
+        return 0ul;
+    }
+
+    const char* str = JsonParser_skip_whitespace(source);
+    if(*str == '\0') {
+        *code = JsonParseCode_empty_source;
+        return 0ul;
+    }
+    if(*str != '{' && *str != '[') {
+        *code = JsonParseCode_malformed_source;
+        return 0ul;
+    }
+
+    JsonBinary_writer_t w;
+    w.dest     = dest;
+    w.dest_len = (dest != NULL ? dest_len : 0ul);
+    w.pos      = 0ul;
+    w.format   = format;
+
+    // the rest of the source after the top-level container is ignored like the parser does
+    if(JsonBinary_encode_source_container(&w, str, 1ul, code) == NULL)
+        return 0ul;
+
+    *code = JsonParseCode_success;
+    return w.pos;
+}
+
+//
+// one CBOR or MessagePack item as far as the decoder cares
+//
+typedef enum {
+    JsonBinary_item_unsigned,
+    JsonBinary_item_signed,
+    JsonBinary_item_negative, // CBOR negative integer, -1 - value
+    JsonBinary_item_float,
+    JsonBinary_item_string,
+    JsonBinary_item_array,
+    JsonBinary_item_map,
+    JsonBinary_item_true,
+    JsonBinary_item_false,
+    JsonBinary_item_null,
+    JsonBinary_item_break,
+    JsonBinary_item_unsupported,
+} JsonBinary_item_kind_t;
+
+typedef struct {
+    JsonBinary_item_kind_t kind;
+    uint64_t value;  // integer value, string length or container count
+    int64_t s;       // JsonBinary_item_signed
+    double r;        // JsonBinary_item_float
+    int digits;      // significant digits that read back as the same float
+    int indefinite;  // CBOR container ended by a break
+} JsonBinary_item_t;
+
+static inline uint64_t JsonBinary_get_be(const unsigned char* p, int bytes) {
+    uint64_t v = 0u;
+    int i;
+    for(i = 0; i < bytes; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static double JsonBinary_float_from_bits(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return (double)f;
+}
+
+static double JsonBinary_double_from_bits(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+//
+// IEEE 754 half precision, only found in CBOR
+//
+static double JsonBinary_half_to_double(unsigned int half) {
+    const uint64_t sign = (uint64_t)(half & 0x8000u) << 48;
+    const unsigned int exp  = (half >> 10) & 0x1fu;
+    const unsigned int mant = half & 0x3ffu;
+
+    if(exp == 0u) { // zero and subnormals
+        const double v = (double)mant * 5.9604644775390625e-08; // 2^-24
+        return sign ? -v : v;
+    } else if(exp == 0x1fu) {
+        return JsonBinary_double_from_bits(sign | (0x7ffull << 52) | ((uint64_t)mant << 42));
+    }
+
+    return JsonBinary_double_from_bits(sign | ((uint64_t)(exp - 15u + 1023u) << 52) | ((uint64_t)mant << 42));
+}
+
+//
+// reads the head of the next item. for strings the returned pointer is the 
+// start of the contents. returns NULL if the input ends too early
+//
+static const unsigned char* JsonBinary_read_cbor(const unsigned char* p, const unsigned char* end, JsonBinary_item_t* item) {
+    item->indefinite = 0;
+
+    for(;;) {
+        if(p >= end)
+            return NULL;
+
+        const unsigned int major = *p >> 5;
+        const unsigned int info  = *p & 0x1fu;
+        p++;
+
+        uint64_t arg = info;
+        if(info >= 24u && info <= 27u) {
+            const int bytes = 1 << (info - 24u);
+            if(end - p < bytes)
+                return NULL;
+            arg = JsonBinary_get_be(p, bytes);
+            p += bytes;
+        } else if(info == 31u && (major == 4u || major == 5u)) {
+            item->indefinite = 1;
+            arg = 0u;
+        } else if(info == 31u && major == 7u) {
+            item->kind = JsonBinary_item_break;
+            return p;
+        } else if(info > 23u) {
+            item->kind = JsonBinary_item_unsupported; // reserved, or a chunked string
+            return p;
+        }
+
+        item->value = arg;
+
+        switch(major) {
+        case 0: item->kind = JsonBinary_item_unsigned; return p;
+        case 1: item->kind = JsonBinary_item_negative; return p;
+        case 3:
+            if(arg > (uint64_t)(end - p))
+                return NULL;
+            item->kind = JsonBinary_item_string;
+            return p;
+        case 4: item->kind = JsonBinary_item_array; return p;
+        case 5: item->kind = JsonBinary_item_map;   return p;
+        case 6: continue; // tags only add meaning to the item that follows
+        case 7:
+            switch(info) {
+            case 20: item->kind = JsonBinary_item_false; return p;
+            case 21: item->kind = JsonBinary_item_true;  return p;
+            case 22:
+            case 23: item->kind = JsonBinary_item_null;  return p; // null and undefined
+            case 25: item->kind = JsonBinary_item_float; item->r = JsonBinary_half_to_double((unsigned int)arg); item->digits = 5;  return p;
+            case 26: item->kind = JsonBinary_item_float; item->r = JsonBinary_float_from_bits((uint32_t)arg);  item->digits = 9;  return p;
+            case 27: item->kind = JsonBinary_item_float; item->r = JsonBinary_double_from_bits(arg);           item->digits = 17; return p;
+            default: item->kind = JsonBinary_item_unsupported; return p;
+            }
+        default: // byte strings
+            item->kind = JsonBinary_item_unsupported;
+            return p;
+        }
+    }
+}
+
+static const unsigned char* JsonBinary_read_msgpack(const unsigned char* p, const unsigned char* end, JsonBinary_item_t* item) {
+    item->indefinite = 0;
+
+    if(p >= end)
+        return NULL;
+
+    const unsigned int b = *p++;
+
+    if(b <= 0x7fu) {
+        item->kind  = JsonBinary_item_unsigned;
+        item->value = b;
+        return p;
+    } else if(b >= 0xe0u) {
+        item->kind = JsonBinary_item_signed;
+        item->s    = (int64_t)b - 0x100;
+        return p;
+    } else if(b <= 0x8fu || (b >= 0x90u && b <= 0x9fu)) {
+        item->kind  = (b <= 0x8fu) ? JsonBinary_item_map : JsonBinary_item_array;
+        item->value = b & 0x0fu;
+        return p;
+    } else if(b <= 0xbfu) {
+        item->kind  = JsonBinary_item_string;
+        item->value = b & 0x1fu;
+        return (item->value <= (uint64_t)(end - p)) ? p : NULL;
+    }
+
+    int bytes = 0;
+    switch(b) {
+    case 0xc0: item->kind = JsonBinary_item_null;  return p;
+    case 0xc2: item->kind = JsonBinary_item_false; return p;
+    case 0xc3: item->kind = JsonBinary_item_true;  return p;
+    case 0xca: case 0xcb:
+        bytes = (b == 0xca) ? 4 : 8;
+        if(end - p < bytes) return NULL;
+        item->kind   = JsonBinary_item_float;
+        item->r      = (b == 0xca) ? JsonBinary_float_from_bits((uint32_t)JsonBinary_get_be(p, 4)) : JsonBinary_double_from_bits(JsonBinary_get_be(p, 8));
+        item->digits = (b == 0xca) ? 9 : 17;
+        return p + bytes;
+    case 0xcc: case 0xcd: case 0xce: case 0xcf:
+        bytes = 1 << (b - 0xccu);
+        if(end - p < bytes) return NULL;
+        item->kind  = JsonBinary_item_unsigned;
+        item->value = JsonBinary_get_be(p, bytes);
+        return p + bytes;
+    case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+        bytes = 1 << (b - 0xd0u);
+        if(end - p < bytes) return NULL;
+        uint64_t v = JsonBinary_get_be(p, bytes);
+        if(bytes < 8 && (v >> (8 * bytes - 1)) != 0u)
+            v |= ~(uint64_t)0 << (8 * bytes); // sign extend
+        item->kind = JsonBinary_item_signed;
+        item->s    = (int64_t)v;
+        return p + bytes;
+    }
+    case 0xd9: case 0xda: case 0xdb:
+        bytes = 1 << (b - 0xd9u);
+        if(end - p < bytes) return NULL;
+        item->kind  = JsonBinary_item_string;
+        item->value = JsonBinary_get_be(p, bytes);
+        p += bytes;
+        return (item->value <= (uint64_t)(end - p)) ? p : NULL;
+    case 0xdc: case 0xdd: case 0xde: case 0xdf:
+        bytes = (b == 0xdc || b == 0xde) ? 2 : 4;
+        if(end - p < bytes) return NULL;
+        item->kind  = (b <= 0xddu) ? JsonBinary_item_array : JsonBinary_item_map;
+        item->value = JsonBinary_get_be(p, bytes);
+        return p + bytes;
+    default: // bin, ext and the unused byte
+        item->kind = JsonBinary_item_unsupported;
+        return p;
+    }
+}
+
+static size_t JsonBinary_format_unsigned(uint64_t v, char* text) {
+    char digits[20];
+    size_t n = 0ul;
+    do {
+        digits[n++] = (char)('0' + (int)(v % 10u));
+        v /= 10u;
+    } while(v != 0u);
+
+    size_t i;
+    for(i = 0ul; i < n; i++)
+        text[i] = digits[n - 1ul - i];
+    return n;
+}
+
+//
+// writes the number as JSON text. returns the number of chars, or 0 for NaN
+//
+static size_t JsonBinary_number_text(const JsonBinary_item_t* item, char* text) {
+    switch(item->kind) {
+    case JsonBinary_item_unsigned:
+        return JsonBinary_format_unsigned(item->value, text);
+
+    case JsonBinary_item_signed:
+        if(item->s >= 0)
+            return JsonBinary_format_unsigned((uint64_t)item->s, text);
+        text[0] = '-';
+        return 1ul + JsonBinary_format_unsigned(0u - (uint64_t)item->s, text + 1);
+
+    case JsonBinary_item_negative:
+        text[0] = '-';
+        if(item->value == UINT64_MAX) { // -2^64 does not fit
+            memcpy(text + 1, "18446744073709551616", 20);
+            return 21ul;
+        }
+        return 1ul + JsonBinary_format_unsigned(item->value + 1u, text + 1);
+
+    default: {
+        const double r = item->r;
+        if(r != r)
+            return 0ul;
+
+        if(r > DBL_MAX || r < -DBL_MAX) { // still reads back as infinity
+            memcpy(text, r > 0.0 ? "1e999" : "-1e999", r > 0.0 ? 5 : 6);
+            return r > 0.0 ? 5ul : 6ul;
+        }
+
+        int n = sprintf(text, "%.*g", item->digits, r);
+        if(strpbrk(text, ".e") == NULL) { // keep it a real number for JsonNumber_convert_from_json_string
+            text[n++] = '.';
+            text[n++] = '0';
+        }
+        return (size_t)n;
+    }
+    }
+}
+
+//
+// while a container is being decoded, its span holds the number of entries 
+// still to come in end, and start is 1 if it is ended by a CBOR break instead. 
+// decoded trees have no source text for spans, so they are cleared again 
+// once the container is closed (or decoding fails)
+//
+static inline void JsonBinary_open_container(JsonNode_t* node, int is_object, int indefinite, JsonOffset_t count) {
+    if(is_object) {
+        node->type      = JsonNodeType_object;
+        node->obj.first = NULL;
+        node->obj.last  = NULL;
+        node->obj.start = indefinite ? 1 : 0;
+        node->obj.end   = count;
+    } else {
+        node->type      = JsonNodeType_array;
+        node->arr.first = NULL;
+        node->arr.last  = NULL;
+        node->arr.start = indefinite ? 1 : 0;
+        node->arr.end   = count;
+    }
+}
+
+static inline JsonNode_t* JsonBinary_close_container(JsonNode_t* node) {
+    JsonNode_t* up = node->parent;
+    if(node->type == JsonNodeType_object) {
+        node->obj.start = 0;
+        node->obj.end   = 0;
+    } else {
+        node->arr.start = 0;
+        node->arr.end   = 0;
+    }
+    return (up != NULL && up->type == JsonNodeType_pair) ? up->parent : up;
+}
+
+JsonParseCode_t JsonBinary_decode(
+        JsonBinaryFormat_t format,
+        JsonDocument_t* doc,
+        char* buffer,
+        size_t input_len,
+        size_t buffer_len) {
+
+    const unsigned char* const base = (const unsigned char*)buffer;
+    const unsigned char* const end  = base + input_len;
+    const unsigned char* p = base;
+
+    doc->first = NULL;
+    doc->error_offset = 0ul;
+
+    JsonNode_t* top = NULL;
+    unsigned long depth = 0ul;
+
+#define JSONBINARY_FAIL(code) \
+    do { \
+        doc->error_offset = (size_t)(p - base); \
+        while(top != NULL) \
+            top = JsonBinary_close_container(top); \
+        return (code); \
+    } while(0)
+
+    if(buffer == NULL || input_len == 0ul)
+        return JsonParseCode_empty_source;
+    if(input_len > JSONPARSER_MAX_OFFSET)
+        return JsonParseCode_offset_overflow;
+    if(buffer_len > JSONPARSER_MAX_OFFSET)
+        buffer_len = JSONPARSER_MAX_OFFSET; // number text must stay addressable
+    if(buffer_len < input_len)
+        return JsonParseCode_allocation_failure; // the input has to fit before any number text
+
+    size_t text = input_len; // where the text of the next number goes
+
+    //
+    // no stack is needed. while a container is open, its span holds the 
+    // number of entries still to come and the container to return to is 
+    // found through its parent link
+    //
+
+    for(;;) {
+        JsonNode_t* parent = NULL; // what the next value hangs off
+        JsonNode_t* elem   = NULL;
+
+        if(top != NULL) {
+            JsonOffset_t* const remaining = (top->type == JsonNodeType_object) ? &top->obj.end : &top->arr.end;
+            const int indefinite = ((top->type == JsonNodeType_object) ? top->obj.start : top->arr.start) != 0;
+
+            int closed = 0;
+            if(indefinite) {
+                if(p < end && *p == 0xff) { // break
+                    p++;
+                    closed = 1;
+                }
+            } else if(*remaining == 0) {
+                closed = 1;
+            } else {
+                (*remaining)--;
+            }
+
+            if(closed) {
+                top = JsonBinary_close_container(top);
+                depth--;
+                if(top == NULL)
+                    return JsonParseCode_success;
+                continue;
+            }
+
+            if(top->type == JsonNodeType_object) {
+                JsonBinary_item_t key;
+                const unsigned char* next = (format == JsonBinaryFormat_cbor) ? 
+                        JsonBinary_read_cbor(p, end, &key) : JsonBinary_read_msgpack(p, end, &key);
+                if(next == NULL) JSONBINARY_FAIL(JsonParseCode_malformed_source);
+                if(key.kind != JsonBinary_item_string) JSONBINARY_FAIL(JsonParseCode_malformed_object);
+
+                JsonNode_t* pair = JsonParser_allocate_document_node(doc);
+                if(pair == NULL) JSONBINARY_FAIL(JsonParseCode_allocation_failure);
+
+                pair->type   = JsonNodeType_pair;
+                pair->flags  = 0u;
+                pair->parent = top;
+                pair->pair.value = NULL;
+                pair->pair.next  = NULL;
+                pair->pair.key_start = (JsonOffset_t)(next - base);
+                pair->pair.key_end   = (JsonOffset_t)(next - base + key.value);
+
+                p = next + key.value;
+                for(; next < p; next++) {
+                    if(*next & 0x80u) {
+                        pair->flags = JsonNodeFlag_non_ascii;
+                        break;
+                    }
+                }
+
+                if(top->obj.first == NULL) top->obj.first = pair;
+                else                       top->obj.last->pair.next = pair;
+                top->obj.last = pair;
+
+                parent = pair;
+            } else {
+                elem = JsonParser_allocate_document_node(doc);
+                if(elem == NULL) JSONBINARY_FAIL(JsonParseCode_allocation_failure);
+
+                elem->type   = JsonNodeType_element;
+                elem->flags  = 0u;
+                elem->parent = top;
+                elem->elem.item = NULL;
+                elem->elem.next = NULL;
+
+                if(top->arr.first == NULL) top->arr.first = elem;
+                else                       top->arr.last->elem.next = elem;
+                top->arr.last = elem;
+
+                parent = top;
+            }
+        }
+
+        JsonBinary_item_t item;
+        const unsigned char* next = (format == JsonBinaryFormat_cbor) ? 
+                JsonBinary_read_cbor(p, end, &item) : JsonBinary_read_msgpack(p, end, &item);
+        if(next == NULL) JSONBINARY_FAIL(JsonParseCode_malformed_source);
+
+        JsonNode_t* node = JsonParser_allocate_document_node(doc);
+        if(node == NULL) JSONBINARY_FAIL(JsonParseCode_allocation_failure);
+
+        node->flags  = 0u;
+        node->parent = parent;
+        if(parent == NULL)                         doc->first = node;
+        else if(parent->type == JsonNodeType_pair) parent->pair.value = node;
+        else                                       elem->elem.item = node;
+
+        switch(item.kind) {
+        case JsonBinary_item_unsigned:
+        case JsonBinary_item_signed:
+        case JsonBinary_item_negative:
+        case JsonBinary_item_float: {
+            char number[32];
+            const size_t len = JsonBinary_number_text(&item, number);
+            if(len == 0ul) JSONBINARY_FAIL(JsonParseCode_number_invalid_char);
+            if(buffer_len - text < len) JSONBINARY_FAIL(JsonParseCode_allocation_failure);
+
+            memcpy(buffer + text, number, len);
+            node->type      = JsonNodeType_number;
+            node->num.start = (JsonOffset_t)text;
+            node->num.end   = (JsonOffset_t)(text + len);
+            text += len;
+            p = next;
+            break;
+        }
+
+        case JsonBinary_item_string:
+            node->type      = JsonNodeType_string;
+            node->str.start = (JsonOffset_t)(next - base);
+            node->str.end   = (JsonOffset_t)(next - base + item.value);
+            p = next + item.value;
+            for(; next < p; next++) {
+                if(*next & 0x80u) {
+                    node->flags = JsonNodeFlag_non_ascii;
+                    break;
+                }
+            }
+            break;
+
+        case JsonBinary_item_array:
+        case JsonBinary_item_map:
+            p = next;
+            // every entry takes at least one byte
+            if(!item.indefinite && item.value > (uint64_t)(end - p))
+                JSONBINARY_FAIL(JsonParseCode_malformed_source);
+            if(++depth > JSONPARSER_MAX_DEPTH) JSONBINARY_FAIL(JsonParseCode_stack_error);
+
+            JsonBinary_open_container(node, item.kind == JsonBinary_item_map, item.indefinite, 
+                    item.indefinite ? 0 : (JsonOffset_t)item.value);
+            top = node;
+            continue;
+
+        case JsonBinary_item_true:  node->type = JsonNodeType_true;  p = next; break;
+        case JsonBinary_item_false: node->type = JsonNodeType_false; p = next; break;
+        case JsonBinary_item_null:  node->type = JsonNodeType_null;  p = next; break;
+
+        case JsonBinary_item_break:
+            JSONBINARY_FAIL(JsonParseCode_malformed_source);
+
+        default: // byte strings, chunked strings, ext types
+            JSONBINARY_FAIL(JsonParseCode_malformed_source);
+        }
+
+        if(top == NULL) // the whole input was a single value
+            return JsonParseCode_success;
+    }
+
+#undef JSONBINARY_FAIL
+}
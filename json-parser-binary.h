@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// conversion of JSON to the binary formats CBOR (RFC 8949) and MessagePack.
+// encoders write into a caller buffer and, like snprintf, return the number
+// of bytes the whole encoding needs. the output is only complete if that is
+// no larger than dest_len, so a NULL dest with dest_len 0 measures the encoding
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+
+typedef enum {
+    JsonBinaryFormat_cbor    = 0,
+    JsonBinaryFormat_msgpack = 1,
+} JsonBinaryFormat_t;
+
+//
+// encode the tree under node. strings and keys are written as UTF-8 with
+// escape sequences decoded like JsonString_copy_utf8. integers from -2^64
+// to 2^64-1 use the smallest integer encoding, in MessagePack only down to
+// -2^63. fractions, exponents and integers out of that range go through
+// JsonNumber_to_double and become a 32-bit float if that holds the value
+// exactly, else a double.
+// returns the size of the encoding, or 0 if the tree contains something
+// that cannot be encoded
+//
+size_t JsonBinary_encode(
+        JsonBinaryFormat_t format,
+        const char* doc_source,
+        const JsonNode_t* node,
+        unsigned char* dest,
+        size_t dest_len);
+
+//
+// encode null-terminated JSON text directly without building a tree.
+// values are encoded the same way as JsonBinary_encode, but the number of
+// entries is not known when a container starts, so CBOR containers use
+// indefinite lengths and non-empty MessagePack containers use array32/map32.
+// code is set to JsonParseCode_success or the reason the source was rejected.
+// returns the size of the encoding, or 0 if the source was rejected
+//
+size_t JsonBinary_encode_source(
+        JsonBinaryFormat_t format,
+        const char* source,
+        unsigned char* dest,
+        size_t dest_len,
+        JsonParseCode_t* code);
+
+//
+// size of the buffer JsonBinary_decode needs for input_len bytes of input
+//
+#define JSONBINARY_DECODE_BUFFER_SIZE(input_len) ((input_len) * 5ul)
+
+//
+// decode CBOR or MessagePack into doc so it can be read with the util 
+// functions like a parsed document. buffer holds the encoded input in its 
+// first input_len bytes and is the doc_source to use afterwards. strings 
+// stay where they are in the input and the text of each number is written 
+// after it, which never needs more than JSONBINARY_DECODE_BUFFER_SIZE(input_len) 
+// bytes in total, and a buffer_len below input_len is rejected. floats 
+// are written with enough digits to read back as the same value.
+// map keys must be strings. CBOR tags are skipped and undefined becomes null. 
+// byte strings, chunked strings, NaN and MessagePack ext types are rejected. 
+// input after the first complete item is ignored.
+// on failure, doc->error_offset is the input offset where decoding stopped 
+// and any partial tree should be released with JsonParser_delete_document
+//
+JsonParseCode_t JsonBinary_decode(
+        JsonBinaryFormat_t format,
+        JsonDocument_t* doc,
+        char* buffer,
+        size_t input_len,
+        size_t buffer_len);
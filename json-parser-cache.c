@@ -0,0 +1,298 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-cache.h"
+
+#include <string.h>
+
+static inline void JsonCache_lock(JsonCache_t* cache) {
+    while(atomic_flag_test_and_set_explicit(&cache->lock, memory_order_acquire))
+        ;
+}
+
+static inline void JsonCache_unlock(JsonCache_t* cache) {
+    atomic_flag_clear_explicit(&cache->lock, memory_order_release);
+}
+
+//
+// hash of the source bytes, 8 at a time
+//
+static uint64_t JsonCache_hash(const char* source, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)len;
+
+    while(len >= 8ul) {
+        uint64_t w;
+        memcpy(&w, source, sizeof(w));
+        h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 32;
+        source += 8;
+        len    -= 8ul;
+    }
+
+    uint64_t w = 0u;
+    memcpy(&w, source, len);
+    h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    return h ^ (h >> 32);
+}
+
+int JsonCache_init(
+        JsonCache_t* cache,
+        size_t num_buckets,
+        size_t budget,
+        JsonCache_alloc_callback alloc_cb,
+        JsonCache_free_callback free_cb,
+        void* alloc_data) {
+
+    if(num_buckets == 0ul || (num_buckets & (num_buckets - 1ul)) != 0ul || alloc_cb == NULL || free_cb == NULL)
+        return 0;
+
+    cache->buckets = (JsonCacheEntry_t**)alloc_cb(alloc_data, num_buckets * sizeof(JsonCacheEntry_t*));
+    if(cache->buckets == NULL)
+        return 0;
+
+    size_t i;
+    for(i = 0ul; i < num_buckets; i++)
+        cache->buckets[i] = NULL;
+
+    cache->mask       = num_buckets - 1ul;
+    cache->lru_first  = NULL;
+    cache->lru_last   = NULL;
+    cache->budget     = budget;
+    cache->used       = 0ul;
+    atomic_flag_clear(&cache->lock);
+    cache->alloc_cb   = alloc_cb;
+    cache->free_cb    = free_cb;
+    cache->alloc_data = alloc_data;
+    cache->hits       = 0ul;
+    cache->misses     = 0ul;
+    cache->evictions  = 0ul;
+    return 1;
+}
+
+static void JsonCache_drop_ref(JsonCache_t* cache, JsonCacheEntry_t* entry) {
+    if(atomic_fetch_sub_explicit(&entry->refs, 1ul, memory_order_acq_rel) == 1ul)
+        cache->free_cb(cache->alloc_data, entry);
+}
+
+static void JsonCache_lru_unlink(JsonCache_t* cache, JsonCacheEntry_t* entry) {
+    if(entry->lru_prev == NULL) cache->lru_first = entry->lru_next;
+    else                        entry->lru_prev->lru_next = entry->lru_next;
+    if(entry->lru_next == NULL) cache->lru_last = entry->lru_prev;
+    else                        entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+static void JsonCache_lru_push_front(JsonCache_t* cache, JsonCacheEntry_t* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_first;
+    if(cache->lru_first == NULL) cache->lru_last = entry;
+    else                         cache->lru_first->lru_prev = entry;
+    cache->lru_first = entry;
+}
+
+//
+// take entry out of the cache, called with the lock held. returns it 
+// so the cache's reference can be dropped after unlocking
+//
+static JsonCacheEntry_t* JsonCache_unlink(JsonCache_t* cache, JsonCacheEntry_t* entry) {
+    JsonCacheEntry_t** link = &cache->buckets[entry->key & cache->mask];
+    while(*link != entry)
+        link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    JsonCache_lru_unlink(cache, entry);
+    cache->used -= entry->size;
+    return entry;
+}
+
+//
+// called with the lock held. takes a reference on a hit
+//
+static JsonCacheEntry_t* JsonCache_find(JsonCache_t* cache, uint64_t key, const char* source, size_t len) {
+    JsonCacheEntry_t* entry;
+    for(entry = cache->buckets[key & cache->mask]; entry != NULL; entry = entry->bucket_next) {
+        if(entry->key == key && entry->source_len == len && memcmp(entry->source, source, len) == 0) {
+            atomic_fetch_add_explicit(&entry->refs, 1ul, memory_order_relaxed);
+            JsonCache_lru_unlink(cache, entry);
+            JsonCache_lru_push_front(cache, entry);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+//
+// nodes for the parse on a miss come in blocks from the cache allocator. 
+// the first node of each block links the blocks together
+//
+typedef struct {
+    JsonCache_t* cache;
+    JsonNode_t* blocks;
+} JsonCache_scratch_t;
+
+static JsonNode_t* JsonCache_alloc_block(void* const alloc_data, size_t* count) {
+    JsonCache_scratch_t* scratch = (JsonCache_scratch_t*)alloc_data;
+    JsonNode_t* block = (JsonNode_t*)scratch->cache->alloc_cb(scratch->cache->alloc_data, (*count + 1ul) * sizeof(JsonNode_t));
+    if(block == NULL)
+        return NULL;
+
+    block->parent = scratch->blocks;
+    scratch->blocks = block;
+    return block + 1;
+}
+
+static void JsonCache_free_blocks(JsonCache_scratch_t* scratch) {
+    while(scratch->blocks != NULL) {
+        JsonNode_t* next = scratch->blocks->parent;
+        scratch->cache->free_cb(scratch->cache->alloc_data, scratch->blocks);
+        scratch->blocks = next;
+    }
+}
+
+//
+// parse source and pack the tree and a copy of the source into one allocation:
+// the entry, the cloned tree (see JsonParser_clone_document), then the source
+//
+static JsonCacheEntry_t* JsonCache_new_entry(JsonCache_t* cache, uint64_t key, const char* source, size_t len, JsonParseCode_t* code) {
+    JsonCache_scratch_t scratch;
+    scratch.cache  = cache;
+    scratch.blocks = NULL;
+
+    JsonDocument_t doc;
+    JsonParser_init_document_block(&doc, NULL, JsonCache_alloc_block, &scratch);
+
+    *code = JsonParser_parse_document(&doc, source);
+    if(*code != JsonParseCode_success) {
+        JsonCache_free_blocks(&scratch);
+        return NULL;
+    }
+
+    const size_t header = (sizeof(JsonCacheEntry_t) + _Alignof(JsonNode_t) - 1ul) & ~(_Alignof(JsonNode_t) - 1ul);
+    const size_t tree   = JsonParser_clone_size(doc.first);
+    const size_t size   = header + tree + len + 1ul;
+
+    JsonCacheEntry_t* entry = (JsonCacheEntry_t*)cache->alloc_cb(cache->alloc_data, size);
+    if(entry == NULL) {
+        JsonCache_free_blocks(&scratch);
+        *code = JsonParseCode_allocation_failure;
+        return NULL;
+    }
+
+    entry->doc_source = JsonParser_clone_document(&entry->doc, source, doc.first, (char*)entry + header, tree);
+    JsonCache_free_blocks(&scratch);
+
+    char* copy = (char*)entry + header + tree;
+    memcpy(copy, source, len);
+    copy[len] = '\0';
+
+    entry->bucket_next = NULL;
+    entry->lru_prev    = NULL;
+    entry->lru_next    = NULL;
+    entry->key         = key;
+    entry->source      = copy;
+    entry->source_len  = len;
+    entry->size        = size;
+    atomic_init(&entry->refs, 1ul);
+    return entry;
+}
+
+const JsonCacheEntry_t* JsonCache_parse(JsonCache_t* cache, const char* source, size_t len, JsonParseCode_t* code) {
+    if(source == NULL) {
+        *code = JsonParseCode_empty_source;
+        return NULL;
+    }
+
+    const uint64_t key = JsonCache_hash(source, len);
+
+    JsonCache_lock(cache);
+    JsonCacheEntry_t* entry = JsonCache_find(cache, key, source, len);
+    if(entry != NULL) cache->hits++;
+    else              cache->misses++;
+    JsonCache_unlock(cache);
+
+    if(entry != NULL) {
+        *code = JsonParseCode_success;
+        return entry;
+    }
+
+    entry = JsonCache_new_entry(cache, key, source, len, code);
+    if(entry == NULL)
+        return NULL;
+
+    if(entry->size > cache->budget)
+        return entry; // never cached, freed when released
+
+    JsonCacheEntry_t* evicted = NULL; // evicted entries are chained through bucket_next
+
+    JsonCache_lock(cache);
+    JsonCacheEntry_t* existing = JsonCache_find(cache, key, source, len); // another thread may have been faster
+    if(existing == NULL) {
+        while(cache->used + entry->size > cache->budget && cache->lru_last != NULL) {
+            JsonCacheEntry_t* victim = JsonCache_unlink(cache, cache->lru_last);
+            victim->bucket_next = evicted;
+            evicted = victim;
+            cache->evictions++;
+        }
+
+        atomic_fetch_add_explicit(&entry->refs, 1ul, memory_order_relaxed); // the cache's reference
+        JsonCacheEntry_t** bucket = &cache->buckets[key & cache->mask];
+        entry->bucket_next = *bucket;
+        *bucket = entry;
+        JsonCache_lru_push_front(cache, entry);
+        cache->used += entry->size;
+    }
+    JsonCache_unlock(cache);
+
+    while(evicted != NULL) {
+        JsonCacheEntry_t* next = evicted->bucket_next;
+        JsonCache_drop_ref(cache, evicted);
+        evicted = next;
+    }
+
+    if(existing != NULL) {
+        JsonCache_drop_ref(cache, entry);
+        return existing;
+    }
+    return entry;
+}
+
+void JsonCache_release(JsonCache_t* cache, const JsonCacheEntry_t* entry) {
+    if(entry != NULL)
+        JsonCache_drop_ref(cache, (JsonCacheEntry_t*)entry);
+}
+
+void JsonCache_clear(JsonCache_t* cache) {
+    JsonCache_lock(cache);
+    JsonCacheEntry_t* entry = cache->lru_first;
+    size_t i;
+    for(i = 0ul; i <= cache->mask; i++)
+        cache->buckets[i] = NULL;
+    cache->lru_first = NULL;
+    cache->lru_last  = NULL;
+    cache->used      = 0ul;
+    JsonCache_unlock(cache);
+
+    while(entry != NULL) {
+        JsonCacheEntry_t* next = entry->lru_next;
+        JsonCache_drop_ref(cache, entry);
+        entry = next;
+    }
+}
+
+void JsonCache_destroy(JsonCache_t* cache) {
+    JsonCache_clear(cache);
+    cache->free_cb(cache->alloc_data, cache->buckets);
+    cache->buckets = NULL;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// cache of parsed documents keyed by the bytes of their source. a hit 
+// skips parsing entirely and hands out the document parsed earlier. 
+// entries are shared read-only (see the note on thread safety in 
+// json-parser-util.h) and reference counted, and the least recently 
+// used ones are evicted to stay within a memory budget.
+//
+// the cache may be used from several threads. lookups take a short lock, 
+// parsing on a miss happens outside of it. the free callback may be 
+// called from whichever thread releases the last reference to an entry
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+typedef void*(*JsonCache_alloc_callback)(void* const alloc_data, size_t size);
+typedef void(*JsonCache_free_callback)(void* const alloc_data, void* ptr);
+
+//
+// one cached document. doc and doc_source are for reading only
+//
+typedef struct JsonCacheEntry {
+    JsonDocument_t doc;
+    const char* doc_source;
+
+    // owned by the cache
+    struct JsonCacheEntry* bucket_next;
+    struct JsonCacheEntry* lru_prev; // towards more recently used
+    struct JsonCacheEntry* lru_next;
+    uint64_t key;
+    const char* source; // copy of the source to check hits against
+    size_t source_len;
+    size_t size;        // bytes allocated for the entry
+    atomic_ulong refs;  // handles plus one while in the cache
+} JsonCacheEntry_t;
+
+typedef struct JsonCache {
+    JsonCacheEntry_t** buckets;
+    size_t mask;                 // number of buckets - 1
+    JsonCacheEntry_t* lru_first; // most recently used
+    JsonCacheEntry_t* lru_last;
+    size_t budget;               // bytes the entries may take up
+    size_t used;
+    atomic_flag lock;
+
+    JsonCache_alloc_callback alloc_cb;
+    JsonCache_free_callback free_cb;
+    void* alloc_data;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+} JsonCache_t;
+
+//
+// num_buckets must be a power of two, the buckets are allocated with alloc_cb.
+// returns 1 on success, else 0
+//
+int JsonCache_init(
+        JsonCache_t* cache,
+        size_t num_buckets,
+        size_t budget,
+        JsonCache_alloc_callback alloc_cb,
+        JsonCache_free_callback free_cb,
+        void* alloc_data);
+
+//
+// get the document for len bytes of source (which must be null-terminated 
+// at source[len]), parsing and caching it on a miss. documents larger than 
+// the whole budget are parsed but not kept. each returned entry holds a 
+// reference that must be given back with JsonCache_release.
+// returns NULL with code set if the source does not parse or memory runs out
+//
+const JsonCacheEntry_t* JsonCache_parse(JsonCache_t* cache, const char* source, size_t len, JsonParseCode_t* code);
+
+//
+// give back a reference from JsonCache_parse. may be called from any thread
+//
+void JsonCache_release(JsonCache_t* cache, const JsonCacheEntry_t* entry);
+
+//
+// drop every entry. entries still referenced are freed once released
+//
+void JsonCache_clear(JsonCache_t* cache);
+
+//
+// clear the cache and free its buckets. the JsonCache_t itself must stay 
+// around until every entry has been released
+//
+void JsonCache_destroy(JsonCache_t* cache);
@@ -0,0 +1,307 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-columns.h"
+#include "json-parser-util.h"
+
+#include <string.h>
+#include <stdint.h>
+
+static inline void JsonColumns_set_bit(unsigned char* bitmap, size_t row, int set) {
+    if(bitmap == NULL)
+        return;
+
+    const unsigned char mask = (unsigned char)(1u << (row & 7u));
+    if(set) bitmap[row >> 3] |= mask;
+    else    bitmap[row >> 3] &= (unsigned char)~mask;
+}
+
+static void JsonColumns_clear_value(JsonColumn_t* col, size_t row) {
+    switch(col->type) {
+    case JsonColumnType_int64:  ((int64_t*)col->values)[row] = 0; break;
+    case JsonColumnType_double: ((double*)col->values)[row] = 0.0; break;
+    case JsonColumnType_bool:   ((unsigned char*)col->values)[row] = 0u; break;
+    case JsonColumnType_string:
+    {
+        JsonColumnString_t* s = (JsonColumnString_t*)col->values + row;
+        s->start = 0;
+        s->end   = 0;
+        s->flags = 0u;
+        break;
+    }
+    }
+}
+
+//
+// every column starts out missing with a zero value
+//
+static void JsonColumns_begin_row(JsonColumn_t* columns, size_t num_columns, size_t row) {
+    size_t i;
+    for(i = 0ul; i < num_columns; i++) {
+        JsonColumns_clear_value(columns + i, row);
+        JsonColumns_set_bit(columns[i].nulls, row, 0);
+        JsonColumns_set_bit(columns[i].missing, row, 1);
+    }
+}
+
+//
+// index of the column named by the key between key_start and key_end, or -1.
+// the search starts at *hint, the column after the previous match, so rows 
+// that list their fields in column order match on the first comparison
+//
+static long JsonColumns_find(
+        const JsonColumn_t* columns, size_t num_columns, size_t* hint,
+        const char* key_start, const char* key_end) {
+
+    const size_t key_len = (size_t)(key_end - key_start);
+
+    size_t n;
+    size_t i = *hint;
+    for(n = 0ul; n < num_columns; n++) {
+        const char* name = columns[i].name;
+        if(strncmp(name, key_start, key_len) == 0 && name[key_len] == '\0') {
+            *hint = (i + 1ul == num_columns) ? 0ul : i + 1ul;
+            return (long)i;
+        }
+        i = (i + 1ul == num_columns) ? 0ul : i + 1ul;
+    }
+    return -1l;
+}
+
+//
+// store value (with offsets relative to doc_source) into row of col
+//
+static void JsonColumns_store(JsonColumn_t* col, size_t row, const char* doc_source, const JsonNode_t* value) {
+    int stored = 0;
+
+    switch(value->type) {
+    case JsonNodeType_null:
+        JsonColumns_clear_value(col, row); // after an earlier duplicate
+        JsonColumns_set_bit(col->nulls, row, 1);
+        JsonColumns_set_bit(col->missing, row, 0);
+        return;
+    case JsonNodeType_number:
+        if(col->type == JsonColumnType_int64)
+            stored = JsonNumber_to_int64(doc_source, value, (int64_t*)col->values + row);
+        else if(col->type == JsonColumnType_double)
+            stored = JsonNumber_to_double(doc_source, value, (double*)col->values + row);
+        break;
+    case JsonNodeType_true:
+    case JsonNodeType_false:
+        if(col->type == JsonColumnType_bool) {
+            ((unsigned char*)col->values)[row] = (value->type == JsonNodeType_true);
+            stored = 1;
+        }
+        break;
+    case JsonNodeType_string:
+        if(col->type == JsonColumnType_string) {
+            JsonColumnString_t* s = (JsonColumnString_t*)col->values + row;
+            s->start = value->str.start;
+            s->end   = value->str.end;
+            s->flags = value->flags;
+            stored = 1;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // a later duplicate of another type leaves the field missing
+    if(!stored)
+        JsonColumns_clear_value(col, row);
+
+    JsonColumns_set_bit(col->nulls, row, 0);
+    JsonColumns_set_bit(col->missing, row, !stored);
+}
+
+size_t JsonColumns_extract(
+        const char* doc_source,
+        const JsonNode_t* arr,
+        JsonColumn_t* columns,
+        size_t num_columns,
+        size_t max_rows) {
+
+    if(doc_source == NULL || arr == NULL || arr->type != JsonNodeType_array)
+        return 0ul;
+
+    size_t hint = 0ul;
+    size_t row  = 0ul;
+    const JsonNode_t* elem;
+
+    for(elem = arr->arr.first; elem != NULL; elem = elem->elem.next, row++) {
+        if(row >= max_rows)
+            continue; // only counting
+
+        JsonColumns_begin_row(columns, num_columns, row);
+
+        const JsonNode_t* item = elem->elem.item;
+        if(item == NULL || item->type != JsonNodeType_object)
+            continue;
+
+        const JsonNode_t* pair;
+        for(pair = item->obj.first; pair != NULL; pair = pair->pair.next) {
+            const long i = JsonColumns_find(
+                    columns, num_columns, &hint, 
+                    doc_source + pair->pair.key_start, doc_source + pair->pair.key_end);
+
+            if(i >= 0l && pair->pair.value != NULL)
+                JsonColumns_store(columns + i, row, doc_source, pair->pair.value);
+        }
+    }
+
+    return row;
+}
+
+size_t JsonColumns_extract_source(
+        const char* source,
+        JsonColumn_t* columns,
+        size_t num_columns,
+        size_t max_rows,
+        JsonParseCode_t* code) {
+
+#define JSONCOLUMNS_FAIL(c) do { *code = (c); return 0ul; } while(0)
+
+    if(source == NULL)
+        JSONCOLUMNS_FAIL(JsonParseCode_empty_source);
+
+    const char* str = JsonParser_skip_whitespace(source);
+    if(*str == '\0')
+        JSONCOLUMNS_FAIL(JsonParseCode_empty_source);
+    if(*str != '[')
+        JSONCOLUMNS_FAIL(JsonParseCode_malformed_source);
+
+    size_t hint = 0ul;
+    size_t row  = 0ul;
+
+    str = JsonParser_skip_whitespace(str + 1);
+    if(*str == ']') {
+        *code = JsonParseCode_success;
+        return 0ul;
+    }
+
+    for(;;) {
+        const int keep = (row < max_rows);
+        if(keep)
+            JsonColumns_begin_row(columns, num_columns, row);
+
+        if(*str != '{' || !keep) {
+            str = JsonParser_skip_value(str, code);
+            if(str == NULL) return 0ul;
+        } else {
+            str = JsonParser_skip_whitespace(str + 1);
+
+            while(*str != '}') {
+                if(*str != '"')
+                    JSONCOLUMNS_FAIL(JsonParseCode_malformed_object);
+
+                unsigned int key_flags;
+                const char* key_end = JsonParser_scan_string(str, &key_flags, code);
+                if(key_end == NULL) return 0ul;
+
+                const long i = JsonColumns_find(columns, num_columns, &hint, str + 1, key_end);
+
+                str = JsonParser_skip_whitespace(key_end + 1);
+                if(*str != ':')
+                    JSONCOLUMNS_FAIL(JsonParseCode_malformed_object);
+                str = JsonParser_skip_whitespace(str + 1);
+
+                // a stand-in node describes the value to JsonColumns_store
+                JsonNode_t value;
+                value.type  = JsonNodeType_none;
+                value.flags = 0u;
+
+                const char c = *str;
+                if(i < 0l || c == '{' || c == '[') {
+                    str = JsonParser_skip_value(str, code);
+                    if(str == NULL) return 0ul;
+                    if(i >= 0l)
+                        value.type = JsonNodeType_object; // never stored, leaves the field missing
+                } else if(c == '"') {
+                    const char* str_end = JsonParser_scan_string(str, &value.flags, code);
+                    if(str_end == NULL) return 0ul;
+                    if((unsigned long long)(str_end - source) > JSONPARSER_MAX_OFFSET)
+                        JSONCOLUMNS_FAIL(JsonParseCode_offset_overflow);
+
+                    value.type      = JsonNodeType_string;
+                    value.str.start = (JsonOffset_t)(str + 1 - source);
+                    value.str.end   = (JsonOffset_t)(str_end - source);
+                    str = str_end + 1;
+                } else if(c == '-' || (c >= '0' && c <= '9')) {
+                    const char* num_end = JsonParser_scan_number(str, code);
+                    if(num_end == NULL) return 0ul;
+                    if((unsigned long long)(num_end - source) > JSONPARSER_MAX_OFFSET)
+                        JSONCOLUMNS_FAIL(JsonParseCode_offset_overflow);
+
+                    value.type      = JsonNodeType_number;
+                    value.num.start = (JsonOffset_t)(str - source);
+                    value.num.end   = (JsonOffset_t)(num_end - source);
+                    str = num_end;
+                } else if(c == 't' && strncmp(str, "true", 4) == 0) {
+                    value.type = JsonNodeType_true;
+                    str += 4;
+                } else if(c == 'f' && strncmp(str, "false", 5) == 0) {
+                    value.type = JsonNodeType_false;
+                    str += 5;
+                } else if(c == 'n' && strncmp(str, "null", 4) == 0) {
+                    value.type = JsonNodeType_null;
+                    str += 4;
+                } else {
+                    JSONCOLUMNS_FAIL(JsonParseCode_malformed_object);
+                }
+
+                if(value.type != JsonNodeType_none)
+                    JsonColumns_store(columns + i, row, source, &value);
+
+                str = JsonParser_skip_whitespace(str);
+                if(*str == ',') {
+                    str = JsonParser_skip_whitespace(str + 1);
+                    if(*str == '}') {
+#ifdef JSONPARSER_NOT_STRICT
+                        break; // trailing comma
+#else
+                        JSONCOLUMNS_FAIL(JsonParseCode_invalid_object_ending);
+#endif // JSONPARSER_NOT_STRICT
+                    }
+                } else if(*str != '}') {
+                    JSONCOLUMNS_FAIL(JsonParseCode_malformed_object);
+                }
+            }
+
+            str++; // closing brace
+        }
+
+        row++;
+
+        str = JsonParser_skip_whitespace(str);
+        if(*str == ',') {
+            str = JsonParser_skip_whitespace(str + 1);
+            if(*str == ']') {
+#ifdef JSONPARSER_NOT_STRICT
+                break; // trailing comma
+#else
+                JSONCOLUMNS_FAIL(JsonParseCode_invalid_array_ending);
+#endif // JSONPARSER_NOT_STRICT
+            }
+        } else if(*str == ']') {
+            break;
+        } else {
+            JSONCOLUMNS_FAIL(JsonParseCode_malformed_array);
+        }
+    }
+
+    *code = JsonParseCode_success;
+    return row;
+
+#undef JSONCOLUMNS_FAIL
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// columnar extraction of an array of objects. each object is one row and 
+// the fields named by the columns are written into one contiguous typed 
+// array per column (struct-of-arrays), so a whole column can be processed 
+// without walking the tree again.
+// like snprintf, extraction returns the number of rows in the array and 
+// only the first max_rows of them are written out
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    JsonColumnType_int64  = 0, // int64_t values, see JsonNumber_to_int64
+    JsonColumnType_double = 1, // double values, see JsonNumber_to_double
+    JsonColumnType_bool   = 2, // unsigned char values, 1 for true and 0 for false
+    JsonColumnType_string = 3, // JsonColumnString_t values
+} JsonColumnType_t;
+
+//
+// location of a string in the source, read it like a string node 
+// (JsonString_copy etc. with start, end and flags)
+//
+typedef struct JsonColumnString {
+    JsonOffset_t start;
+    JsonOffset_t end;
+    unsigned int flags;
+} JsonColumnString_t;
+
+//
+// one bit per row, least significant bit first
+//
+#define JSONCOLUMN_BITMAP_SIZE(rows) (((rows) + 7ul) / 8ul)
+
+#define JSONCOLUMN_BIT(bitmap, row) (((bitmap)[(row) >> 3] >> ((row) & 7u)) & 1u)
+
+typedef struct JsonColumn {
+    const char* name;       // field name, compared with the raw (escaped) key
+    JsonColumnType_t type;
+    void* values;           // max_rows values of the column type
+    unsigned char* nulls;   // bit set where the field is null, may be NULL
+    unsigned char* missing; // bit set where the field is absent or has another type, may be NULL
+} JsonColumn_t;
+
+//
+// extract the rows of an array node. rows that are not objects have every 
+// column missing. if a field appears more than once, the last one wins.
+// values of rows where a column is null or missing are zero.
+// returns the number of rows in arr, or 0 if arr is not an array
+//
+size_t JsonColumns_extract(
+        const char* doc_source,
+        const JsonNode_t* arr,
+        JsonColumn_t* columns,
+        size_t num_columns,
+        size_t max_rows);
+
+//
+// extract the rows of null-terminated JSON text whose root is an array, in 
+// a single pass without building a tree. string offsets are relative to 
+// source. fields that are not extracted are skipped with JsonParser_skip_value, 
+// which only checks their brackets balance.
+// code is set to JsonParseCode_success or the reason the source was rejected.
+// returns the number of rows, or 0 if the source was rejected
+//
+size_t JsonColumns_extract_source(
+        const char* source,
+        JsonColumn_t* columns,
+        size_t num_columns,
+        size_t max_rows,
+        JsonParseCode_t* code);
@@ -20,18 +20,46 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 //
 ///#define JSONPARSER_HAS_MALLOC
 
+//
+// makes JsonMappedFile_t (json-parser-mmap.h) available.
+// requires a POSIX system
+//
+#define JSONPARSER_HAS_MMAP
+
 //
 // allows arrays to end with ,] and objects with ,}
 // true, false, null are case-insensitive
+// default for JsonParserOptions_t.strict, can be chosen per parse
 //
 #define JSONPARSER_NOT_STRICT
 
 //
-// used to determine max nested depth of JSON documents.
-// this is not an exact measurement as there are internal
-// nested behaviors as well
+// max nested depth of objects/arrays in JSON documents.
+// parsing and deleting documents do not use a stack, deeper documents 
+// report JsonParseCode_stack_error. writing, copying, cloning and binary 
+// encoding recurse once per level, so the editing functions refuse to 
+// nest values deeper as well. JsonParserOptions_t.max_depth can lower it per parse
+//
+#define JSONPARSER_MAX_DEPTH 4096
+
+//
+// use 64-bit offsets into the source (JsonOffset_t) so documents 
+// larger than 4 GiB can be parsed. this makes every node larger.
+// without it, larger documents report JsonParseCode_offset_overflow
 //
-#define JSONPARSER_MAX_DEPTH 64
+///#define JSONPARSER_LARGE_DOCUMENTS
+
+//
+// gather JsonParseStats_t (node counts, depth, bytes, timings) for 
+// documents with stats attached. without it there is no overhead at all
+//
+///#define JSONPARSER_COLLECT_STATS
+
+//
+// number of nodes the parser asks for at once from 
+// documents using a block allocator (JsonParser_init_document_block)
+//
+#define JSONPARSER_ALLOC_BLOCK_SIZE 256
 
 //
 // defines the size of the char buffer used internally to convert 
@@ -44,6 +72,13 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 //
 #define JSONPARSER_USE_UTF8
 
+//
+// validate that the contents of strings are well-formed utf-8 
+// while parsing. documents that are not report JsonParseCode_invalid_utf8
+// default for JsonParserOptions_t.validate_utf8, can be chosen per parse
+//
+///#define JSONPARSER_VALIDATE_UTF8
+
 //
 // if utf-8 encoding is supported, convert extended chars to given.
 // this is used when copying strings out via JsonString_t
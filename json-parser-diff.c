@@ -0,0 +1,430 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-diff.h"
+#include "json-parser-edit.h"
+#include "json-parser-util.h"
+
+#include <string.h>
+
+// objects needing fewer slots than this are matched by a linear search
+#define JSONDIFF_MIN_INDEX_SLOTS 16ul
+
+//
+// output position keeps counting past the end of dest so
+// the full length of the text is always known
+//
+typedef struct {
+    char* dest;
+    size_t dest_len;
+    size_t pos;
+} JsonDiff_writer_t;
+
+static inline void JsonDiff_put(JsonDiff_writer_t* w, const char c) {
+    if(w->pos < w->dest_len)
+        w->dest[w->pos] = c;
+    w->pos++;
+}
+
+static void JsonDiff_put_text(JsonDiff_writer_t* w, const char* text) {
+    while(*text)
+        JsonDiff_put(w, *text++);
+}
+
+static void JsonDiff_finish(JsonDiff_writer_t* w) {
+    if(w->pos < w->dest_len)        w->dest[w->pos] = '\0';
+    else if(w->dest_len > 0ul)      w->dest[w->dest_len - 1ul] = '\0';
+}
+
+//
+// one byte of a path token, escaped for JSON Pointer and, 
+// inside a JSON string, for JSON as well
+//
+static void JsonDiff_put_token_byte(JsonDiff_writer_t* w, const char c, const int in_json) {
+    if(c == '~') {
+        JsonDiff_put(w, '~');
+        JsonDiff_put(w, '0');
+    } else if(c == '/') {
+        JsonDiff_put(w, '~');
+        JsonDiff_put(w, '1');
+    } else if(in_json && (c == '"' || c == '\\')) {
+        JsonDiff_put(w, '\\');
+        JsonDiff_put(w, c);
+    } else if(in_json && (unsigned char)c < 0x20u) {
+        static const char hex[] = "0123456789abcdef";
+        JsonDiff_put_text(w, "\\u00");
+        JsonDiff_put(w, hex[((unsigned char)c >> 4) & 0x0Fu]);
+        JsonDiff_put(w, hex[(unsigned char)c & 0x0Fu]);
+    } else {
+        JsonDiff_put(w, c);
+    }
+}
+
+static void JsonDiff_put_path(JsonDiff_writer_t* w, const JsonDiffPath_t* path, const int in_json) {
+    if(path == NULL)
+        return;
+
+    JsonDiff_put_path(w, path->up, in_json);
+    JsonDiff_put(w, '/');
+
+    if(path->pair == NULL) {
+        char digits[24];
+        size_t n = 0ul;
+        size_t idx = path->index;
+        do {
+            digits[n++] = (char)('0' + idx % 10ul);
+            idx /= 10ul;
+        } while(idx != 0ul);
+        while(n > 0ul)
+            JsonDiff_put(w, digits[--n]);
+        return;
+    }
+
+    const char* src = path->doc_source + path->pair->pair.key_start;
+    const char* end = path->doc_source + path->pair->pair.key_end;
+    const int escaped = (path->pair->flags & JsonNodeFlag_escaped) != 0u;
+
+    while(src != end) {
+        if(escaped && *src == '\\') {
+            char decoded[8];
+            size_t n = 0ul;
+            size_t i;
+            src = JsonParser_decode_escape(src, end, decoded, &n);
+            for(i = 0ul; i < n; i++)
+                JsonDiff_put_token_byte(w, decoded[i], in_json);
+        } else {
+            JsonDiff_put_token_byte(w, *src++, in_json);
+        }
+    }
+}
+
+size_t JsonDiffPath_write(const JsonDiffPath_t* path, char* dest, size_t dest_len) {
+    JsonDiff_writer_t w;
+    w.dest     = dest;
+    w.dest_len = dest_len;
+    w.pos      = 0ul;
+
+    JsonDiff_put_path(&w, path, 0);
+    JsonDiff_finish(&w);
+    return w.pos;
+}
+
+typedef struct {
+    const char* a_source;
+    const char* b_source;
+    JsonNode_t** slots;
+    size_t num_slots;
+    size_t used; // slots taken by the objects being compared
+    JsonDiff_callback cb;
+    void* cb_data;
+} JsonDiff_t;
+
+//
+// containers straight from the parser that have the same text are the same
+//
+static int JsonDiff_same_text(const JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b) {
+    JsonOffset_t a_start, a_end, b_start, b_end;
+
+    if(a->type == JsonNodeType_object) {
+        a_start = a->obj.start; a_end = a->obj.end;
+        b_start = b->obj.start; b_end = b->obj.end;
+    } else {
+        a_start = a->arr.start; a_end = a->arr.end;
+        b_start = b->arr.start; b_end = b->arr.end;
+    }
+
+    return 
+            a_end > a_start && b_end > b_start && a_end - a_start == b_end - b_start && 
+            memcmp(d->a_source + a_start, d->b_source + b_start, (size_t)(a_end - a_start)) == 0;
+}
+
+static int JsonDiff_same(const JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b) {
+    if(a->type != b->type)
+        return 0;
+    if((a->type == JsonNodeType_object || a->type == JsonNodeType_array) && JsonDiff_same_text(d, a, b))
+        return 1;
+    return JsonNode_equal(d->a_source, a, d->b_source, b, 1);
+}
+
+static inline int JsonDiff_emit(const JsonDiff_t* d, JsonDiffOp_t op, const JsonDiffPath_t* path, const JsonNode_t* value) {
+    return d->cb(d->cb_data, op, path, d->b_source, value);
+}
+
+static int JsonDiff_value(JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b, const JsonDiffPath_t* path);
+
+//
+// fields of one side of an object comparison. snapshots of a document 
+// mostly keep their fields in the same order, so the field after the 
+// last one found is tried first and the hash index is only built once 
+// that fails
+//
+typedef struct {
+    const char* source;
+    const JsonNode_t* obj;
+    const JsonNode_t* cursor;
+    JsonObjIndex_t index;
+    int indexed; // 1 once index is built, -1 if it cannot be
+} JsonDiff_fields_t;
+
+static void JsonDiff_fields_init(JsonDiff_fields_t* f, const char* source, const JsonNode_t* obj) {
+    f->source  = source;
+    f->obj     = obj;
+    f->cursor  = obj->obj.first;
+    f->indexed = 0;
+}
+
+static inline int JsonDiff_key_is(const char* source, const JsonNode_t* pair, const char* key, size_t len) {
+    return 
+            (size_t)(pair->pair.key_end - pair->pair.key_start) == len && 
+            memcmp(source + pair->pair.key_start, key, len) == 0;
+}
+
+//
+// the field of f named like pair, which is from the other side
+//
+static const JsonNode_t* JsonDiff_find_field(JsonDiff_t* d, JsonDiff_fields_t* f, const char* pair_source, const JsonNode_t* pair) {
+    const char* key  = pair_source + pair->pair.key_start;
+    const size_t len = (size_t)(pair->pair.key_end - pair->pair.key_start);
+    const JsonNode_t* found = NULL;
+
+    if(f->cursor != NULL && JsonDiff_key_is(f->source, f->cursor, key, len)) {
+        found = f->cursor;
+        f->cursor = found->pair.next;
+        return found;
+    }
+
+    if(f->indexed == 0) {
+        const size_t num_slots = JsonObjIndex_slots_needed(f->obj);
+        f->indexed = -1;
+        if(num_slots >= JSONDIFF_MIN_INDEX_SLOTS && num_slots <= d->num_slots - d->used && 
+                JsonObjIndex_init(&f->index, f->source, (JsonNode_t*)f->obj, d->slots + d->used, num_slots)) {
+            d->used += num_slots;
+            f->indexed = 1;
+        }
+    }
+
+    if(f->indexed == 1) {
+        found = JsonObjIndex_find_key(&f->index, key, len);
+    } else {
+        const JsonNode_t* iter;
+        for(iter = f->obj->obj.first; iter != NULL && found == NULL; iter = iter->pair.next)
+            if(JsonDiff_key_is(f->source, iter, key, len))
+                found = iter;
+    }
+
+    if(found != NULL)
+        f->cursor = found->pair.next;
+    return found;
+}
+
+static int JsonDiff_object(JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b, const JsonDiffPath_t* path) {
+    if(JsonDiff_same_text(d, a, b))
+        return 1;
+
+    const size_t used = d->used;
+    JsonDiff_fields_t a_fields, b_fields;
+    JsonDiff_fields_init(&a_fields, d->a_source, a);
+    JsonDiff_fields_init(&b_fields, d->b_source, b);
+
+    JsonDiffPath_t step;
+    step.up    = path;
+    step.index = 0ul;
+
+    int ok = 1;
+    const JsonNode_t* pair;
+
+    // fields that are gone come out first, so adding a field never 
+    // meets one of the same name that is about to be removed
+    step.doc_source = d->a_source;
+    for(pair = a->obj.first; ok && pair != NULL; pair = pair->pair.next) {
+        if(JsonDiff_find_field(d, &b_fields, d->a_source, pair) == NULL) {
+            step.pair = pair;
+            ok = JsonDiff_emit(d, JsonDiffOp_remove, &step, NULL);
+        }
+    }
+
+    step.doc_source = d->b_source;
+    for(pair = b->obj.first; ok && pair != NULL; pair = pair->pair.next) {
+        const JsonNode_t* old = JsonDiff_find_field(d, &a_fields, d->b_source, pair);
+        step.pair = pair;
+        if(old != NULL) ok = JsonDiff_value(d, old->pair.value, pair->pair.value, &step);
+        else            ok = JsonDiff_emit(d, JsonDiffOp_add, &step, pair->pair.value);
+    }
+
+    d->used = used;
+    return ok;
+}
+
+static int JsonDiff_array(JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b, const JsonDiffPath_t* path) {
+    if(JsonDiff_same_text(d, a, b))
+        return 1;
+
+    size_t a_len = 0ul, b_len = 0ul;
+    const JsonNode_t* elem;
+    for(elem = a->arr.first; elem != NULL; elem = elem->elem.next) a_len++;
+    for(elem = b->arr.first; elem != NULL; elem = elem->elem.next) b_len++;
+
+    // skip the common start
+    const JsonNode_t* a_elem = a->arr.first;
+    const JsonNode_t* b_elem = b->arr.first;
+    size_t prefix = 0ul;
+    while(a_elem != NULL && b_elem != NULL && JsonDiff_same(d, a_elem->elem.item, b_elem->elem.item)) {
+        a_elem = a_elem->elem.next;
+        b_elem = b_elem->elem.next;
+        prefix++;
+    }
+
+    // measure the common end by lining up the ends of what is left
+    const size_t a_rest = a_len - prefix;
+    const size_t b_rest = b_len - prefix;
+    const size_t rest   = (a_rest < b_rest) ? a_rest : b_rest;
+
+    const JsonNode_t* a_tail = a_elem;
+    const JsonNode_t* b_tail = b_elem;
+    size_t i;
+    for(i = rest; i < a_rest; i++) a_tail = a_tail->elem.next;
+    for(i = rest; i < b_rest; i++) b_tail = b_tail->elem.next;
+
+    size_t suffix = rest;
+    for(i = 0ul; i < rest; i++) {
+        if(!JsonDiff_same(d, a_tail->elem.item, b_tail->elem.item))
+            suffix = rest - i - 1ul;
+        a_tail = a_tail->elem.next;
+        b_tail = b_tail->elem.next;
+    }
+
+    // the middle is compared element by element, then grown or shrunk at its end
+    const size_t a_mid = a_rest - suffix;
+    const size_t b_mid = b_rest - suffix;
+    const size_t both  = (a_mid < b_mid) ? a_mid : b_mid;
+
+    JsonDiffPath_t step;
+    step.up         = path;
+    step.doc_source = NULL;
+    step.pair       = NULL;
+
+    for(i = 0ul; i < both; i++) {
+        step.index = prefix + i;
+        if(!JsonDiff_value(d, a_elem->elem.item, b_elem->elem.item, &step))
+            return 0;
+        a_elem = a_elem->elem.next;
+        b_elem = b_elem->elem.next;
+    }
+
+    for(i = both; i < b_mid; i++) {
+        step.index = prefix + i;
+        if(!JsonDiff_emit(d, JsonDiffOp_add, &step, b_elem->elem.item))
+            return 0;
+        b_elem = b_elem->elem.next;
+    }
+
+    step.index = prefix + both; // each removal moves the next element here
+    for(i = both; i < a_mid; i++)
+        if(!JsonDiff_emit(d, JsonDiffOp_remove, &step, NULL))
+            return 0;
+
+    return 1;
+}
+
+static int JsonDiff_value(JsonDiff_t* d, const JsonNode_t* a, const JsonNode_t* b, const JsonDiffPath_t* path) {
+    if(a->type != b->type)
+        return JsonDiff_emit(d, JsonDiffOp_replace, path, b);
+
+    switch(a->type) {
+    case JsonNodeType_object:
+        return JsonDiff_object(d, a, b, path);
+    case JsonNodeType_array:
+        return JsonDiff_array(d, a, b, path);
+    case JsonNodeType_string:
+    case JsonNodeType_number:
+        if(JsonNode_equal(d->a_source, a, d->b_source, b, 1))
+            return 1;
+        return JsonDiff_emit(d, JsonDiffOp_replace, path, b);
+    default: // the same literal
+        return 1;
+    }
+}
+
+int JsonDiff_documents(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        JsonNode_t** slots, size_t num_slots,
+        JsonDiff_callback cb, void* const cb_data) {
+
+    JsonDiff_t d;
+    d.a_source  = a_source;
+    d.b_source  = b_source;
+    d.slots     = slots;
+    d.num_slots = (slots != NULL) ? num_slots : 0ul;
+    d.used      = 0ul;
+    d.cb        = cb;
+    d.cb_data   = cb_data;
+
+    if(a == NULL && b == NULL)
+        return 1;
+    if(a == NULL)
+        return JsonDiff_emit(&d, JsonDiffOp_add, NULL, b);
+    if(b == NULL)
+        return JsonDiff_emit(&d, JsonDiffOp_remove, NULL, NULL);
+    return JsonDiff_value(&d, a, b, NULL);
+}
+
+typedef struct {
+    JsonDiff_writer_t w;
+    int first;
+} JsonDiff_patch_t;
+
+static int JsonDiff_write_op(void* const cb_data, JsonDiffOp_t op, const JsonDiffPath_t* path, const char* value_source, const JsonNode_t* value) {
+    JsonDiff_patch_t* p = (JsonDiff_patch_t*)cb_data;
+    JsonDiff_writer_t* w = &p->w;
+
+    if(!p->first)
+        JsonDiff_put(w, ',');
+    p->first = 0;
+
+    JsonDiff_put_text(w, "{\"op\":\"");
+    JsonDiff_put_text(w, (op == JsonDiffOp_add) ? "add" : (op == JsonDiffOp_remove) ? "remove" : "replace");
+    JsonDiff_put_text(w, "\",\"path\":\"");
+    JsonDiff_put_path(w, path, 1);
+    JsonDiff_put(w, '"');
+
+    if(value != NULL) {
+        JsonDiff_put_text(w, ",\"value\":");
+        if(w->pos < w->dest_len) w->pos += JsonEdit_write(value_source, value, w->dest + w->pos, w->dest_len - w->pos);
+        else                     w->pos += JsonEdit_write(value_source, value, NULL, 0ul);
+    }
+
+    JsonDiff_put(w, '}');
+    return 1;
+}
+
+size_t JsonDiff_write_patch(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        JsonNode_t** slots, size_t num_slots,
+        char* dest, size_t dest_len) {
+
+    JsonDiff_patch_t p;
+    p.w.dest     = dest;
+    p.w.dest_len = dest_len;
+    p.w.pos      = 0ul;
+    p.first      = 1;
+
+    JsonDiff_put(&p.w, '[');
+    JsonDiff_documents(a_source, a, b_source, b, slots, num_slots, JsonDiff_write_op, &p);
+    JsonDiff_put(&p.w, ']');
+
+    JsonDiff_finish(&p.w);
+    return p.w.pos;
+}
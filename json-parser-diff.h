@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// structural diff of two parsed documents. the changes that turn a into 
+// b are reported as JSON Patch (RFC 6902) operations, either one at a 
+// time through a callback or written out as the text of a patch that 
+// JsonPatch_apply accepts. identical subtrees are skipped with a memcmp 
+// of their source text when both were parsed, else by JsonNode_equal. 
+// fields are matched by their raw key bytes. the field after the last 
+// match is tried first, which finds every field of objects that keep 
+// their order, and the rest are looked up in hash indexes built in 
+// caller-supplied slots, so objects cost O(fields) instead of a 
+// JsonObj_field_by_name per field. arrays are compared element by 
+// element after trimming their common start and end, so an insert or 
+// removal in the middle of an array is one operation.
+//
+// neither document is modified. changes are reported in the order they 
+// have to be applied, with removals from an object before the fields 
+// that are added to it
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+
+typedef enum {
+    JsonDiffOp_add,
+    JsonDiffOp_remove,
+    JsonDiffOp_replace,
+} JsonDiffOp_t;
+
+//
+// location of a change, as a chain of keys and array indexes leading up 
+// to the root (NULL). only valid during the callback it is passed to
+//
+typedef struct JsonDiffPath {
+    const struct JsonDiffPath* up;
+    const char* doc_source; // source of pair
+    const JsonNode_t* pair; // the key of this step, or NULL for an array index
+    size_t index;
+} JsonDiffPath_t;
+
+//
+// write path as a JSON Pointer ("" for the root, "/a/0" and so on) with 
+// keys unescaped and '~' and '/' written as "~0" and "~1". like snprintf, 
+// returns the length of the whole text and writes at most dest_len bytes 
+// including a null terminator
+//
+size_t JsonDiffPath_write(const JsonDiffPath_t* path, char* dest, size_t dest_len);
+
+//
+// called for every change. value is the new value in b for add and 
+// replace, and NULL for remove. return 0 to stop the diff
+//
+typedef int(*JsonDiff_callback)(
+        void* const cb_data, JsonDiffOp_t op, const JsonDiffPath_t* path,
+        const char* value_source, const JsonNode_t* value);
+
+//
+// report the changes from a to b. objects with more than a few fields 
+// are indexed in slots when needed, which are used like a stack as the 
+// diff descends. num_slots of twice the sum of the fields of the largest 
+// objects on both sides along any path is always enough (see 
+// JsonObjIndex_slots_needed). objects that do not fit are matched by a 
+// linear search. slots may be NULL.
+// returns 1 once every change was reported, 0 if the callback stopped it
+//
+int JsonDiff_documents(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        JsonNode_t** slots, size_t num_slots,
+        JsonDiff_callback cb, void* const cb_data);
+
+//
+// write the changes from a to b as a JSON Patch, "[]" if there are none. 
+// values are written as by JsonEdit_write. like snprintf, returns the 
+// length of the whole patch and writes at most dest_len bytes including 
+// a null terminator
+//
+size_t JsonDiff_write_patch(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        JsonNode_t** slots, size_t num_slots,
+        char* dest, size_t dest_len);
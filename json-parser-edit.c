@@ -0,0 +1,662 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-edit.h"
+#include "json-parser-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void JsonEditBuffer_init(JsonEditBuffer_t* buf, char* data, size_t len, size_t size) {
+    buf->data = data;
+    buf->len  = len;
+    buf->size = size;
+}
+
+//
+// copy len bytes of text to the end of buf. returns the offset of the 
+// copy or sets ok to 0 if it does not fit
+//
+static JsonOffset_t JsonEdit_store_text(JsonEditBuffer_t* buf, const char* text, size_t len, int* ok) {
+    if(buf->len > buf->size || len > buf->size - buf->len || (unsigned long long)(buf->len + len) > JSONPARSER_MAX_OFFSET) {
+        *ok = 0;
+        return 0;
+    }
+
+    const JsonOffset_t start = (JsonOffset_t)buf->len;
+    memcpy(buf->data + buf->len, text, len);
+    buf->len += len;
+    *ok = 1;
+    return start;
+}
+
+static unsigned int JsonEdit_text_flags(const char* text, size_t len) {
+    size_t i;
+    for(i = 0ul; i < len; i++)
+        if((unsigned char)text[i] & 0x80u)
+            return JsonNodeFlag_non_ascii;
+    return 0u;
+}
+
+//
+// a node from the document with every field set, since nodes 
+// from a single node callback may not be initialized
+//
+static JsonNode_t* JsonEdit_new_node(JsonDocument_t* doc, JsonNodeType_t type) {
+    JsonNode_t* node = JsonParser_allocate_document_node(doc);
+    if(node == NULL)
+        return NULL;
+
+    node->type   = type;
+    node->flags  = 0u;
+    node->parent = NULL;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.value     = NULL;
+    node->pair.next      = NULL;
+    return node;
+}
+
+JsonNode_t* JsonEdit_new_object(JsonDocument_t* doc) {
+    return JsonEdit_new_node(doc, JsonNodeType_object);
+}
+
+JsonNode_t* JsonEdit_new_array(JsonDocument_t* doc) {
+    return JsonEdit_new_node(doc, JsonNodeType_array);
+}
+
+JsonNode_t* JsonEdit_new_literal(JsonDocument_t* doc, JsonNodeType_t type) {
+    if(type != JsonNodeType_true && type != JsonNodeType_false && type != JsonNodeType_null)
+        return NULL;
+    return JsonEdit_new_node(doc, type);
+}
+
+JsonNode_t* JsonEdit_new_string(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* str, size_t len) {
+    int ok;
+    const JsonOffset_t start = JsonEdit_store_text(buf, str, len, &ok);
+    if(!ok)
+        return NULL;
+
+    JsonNode_t* node = JsonEdit_new_node(doc, JsonNodeType_string);
+    if(node == NULL) {
+        buf->len = start; // give the text back
+        return NULL;
+    }
+
+    node->flags     = JsonEdit_text_flags(str, len);
+    node->str.start = start;
+    node->str.end   = start + (JsonOffset_t)len;
+    return node;
+}
+
+static JsonNode_t* JsonEdit_new_number_text(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* text, size_t len) {
+    int ok;
+    const JsonOffset_t start = JsonEdit_store_text(buf, text, len, &ok);
+    if(!ok)
+        return NULL;
+
+    JsonNode_t* node = JsonEdit_new_node(doc, JsonNodeType_number);
+    if(node == NULL) {
+        buf->len = start;
+        return NULL;
+    }
+
+    node->num.start = start;
+    node->num.end   = start + (JsonOffset_t)len;
+    return node;
+}
+
+JsonNode_t* JsonEdit_new_int64(JsonDocument_t* doc, JsonEditBuffer_t* buf, int64_t value) {
+    char text[24];
+    const int len = snprintf(text, sizeof(text), "%lld", (long long)value);
+    return JsonEdit_new_number_text(doc, buf, text, (size_t)len);
+}
+
+JsonNode_t* JsonEdit_new_double(JsonDocument_t* doc, JsonEditBuffer_t* buf, double value) {
+    if(!isfinite(value))
+        return NULL;
+
+    // shortest of these that reads back as the same value
+    char text[32];
+    int len = 0;
+    int precision;
+    for(precision = 15; precision <= 17; precision++) {
+        len = snprintf(text, sizeof(text), "%.*g", precision, value);
+        if(strtod(text, NULL) == value)
+            break;
+    }
+    return JsonEdit_new_number_text(doc, buf, text, (size_t)len);
+}
+
+static JsonNode_t* JsonEdit_new_element(JsonDocument_t* doc, JsonNode_t* arr, JsonNode_t* value) {
+    JsonNode_t* elem = JsonEdit_new_node(doc, JsonNodeType_element);
+    if(elem == NULL)
+        return NULL;
+
+    elem->parent    = arr;
+    elem->elem.item = value;
+    value->parent   = arr;
+    return elem;
+}
+
+//
+// copies below node, linked in as they are made so a partial copy 
+// can be released as a whole
+//
+static int JsonEdit_copy_into(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* src_source, const JsonNode_t* src, JsonNode_t* node) {
+    int ok = 1;
+    const JsonNode_t* iter;
+    JsonNode_t* last = NULL;
+
+    switch(src->type) {
+    case JsonNodeType_object:
+        for(iter = src->obj.first; iter != NULL; iter = iter->pair.next) {
+            JsonNode_t* pair = JsonEdit_new_node(doc, JsonNodeType_pair);
+            if(pair == NULL)
+                return 0;
+
+            pair->flags  = iter->flags;
+            pair->parent = node;
+            if(last == NULL) node->obj.first = pair;
+            else             last->pair.next = pair;
+            node->obj.last = last = pair;
+
+            pair->pair.key_start = JsonEdit_store_text(buf, src_source + iter->pair.key_start, iter->pair.key_end - iter->pair.key_start, &ok);
+            pair->pair.key_end   = pair->pair.key_start + (iter->pair.key_end - iter->pair.key_start);
+            if(!ok)
+                return 0;
+
+            JsonNode_t* value = JsonEdit_new_node(doc, iter->pair.value->type);
+            if(value == NULL)
+                return 0;
+            value->parent = pair;
+            pair->pair.value = value;
+            if(!JsonEdit_copy_into(doc, buf, src_source, iter->pair.value, value))
+                return 0;
+        }
+        return 1;
+
+    case JsonNodeType_array:
+        for(iter = src->arr.first; iter != NULL; iter = iter->elem.next) {
+            JsonNode_t* item = JsonEdit_new_node(doc, iter->elem.item->type);
+            if(item == NULL)
+                return 0;
+
+            JsonNode_t* elem = JsonEdit_new_element(doc, node, item);
+            if(elem == NULL) {
+                JsonParser_release_document_nodes(doc, item);
+                return 0;
+            }
+            if(last == NULL) node->arr.first = elem;
+            else             last->elem.next = elem;
+            node->arr.last = last = elem;
+
+            if(!JsonEdit_copy_into(doc, buf, src_source, iter->elem.item, item))
+                return 0;
+        }
+        return 1;
+
+    case JsonNodeType_string:
+        node->flags     = src->flags;
+        node->str.start = JsonEdit_store_text(buf, src_source + src->str.start, src->str.end - src->str.start, &ok);
+        node->str.end   = node->str.start + (src->str.end - src->str.start);
+        return ok;
+
+    case JsonNodeType_number:
+        node->num.start = JsonEdit_store_text(buf, src_source + src->num.start, src->num.end - src->num.start, &ok);
+        node->num.end   = node->num.start + (src->num.end - src->num.start);
+        return ok;
+
+    default: // true, false and null have no text
+        return 1;
+    }
+}
+
+JsonNode_t* JsonEdit_copy(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* src_source, const JsonNode_t* src) {
+    if(src == NULL || src->type == JsonNodeType_none || src->type == JsonNodeType_pair || src->type == JsonNodeType_element)
+        return NULL;
+
+    const size_t len = buf->len;
+    JsonNode_t* node = JsonEdit_new_node(doc, src->type);
+    if(node == NULL)
+        return NULL;
+
+    if(!JsonEdit_copy_into(doc, buf, src_source, src, node)) {
+        JsonParser_release_document_nodes(doc, node);
+        buf->len = len; // give the text back
+        return NULL;
+    }
+    return node;
+}
+
+//
+// node and every container above it no longer match their source text
+//
+static void JsonEdit_touch(JsonNode_t* node) {
+    for(; node != NULL; node = node->parent) {
+        if(node->type == JsonNodeType_object) {
+            node->obj.start = 0;
+            node->obj.end   = 0;
+        } else if(node->type == JsonNodeType_array) {
+            node->arr.start = 0;
+            node->arr.end   = 0;
+        }
+    }
+}
+
+//
+// checks that value can be linked into the tree
+//
+static inline int JsonEdit_is_detached(const JsonDocument_t* doc, const JsonNode_t* value) {
+    return 
+            value != NULL && value->parent == NULL && value != doc->first && 
+            value->type != JsonNodeType_none && value->type != JsonNodeType_pair && value->type != JsonNodeType_element;
+}
+
+//
+// containers in the tree under node are nested at most room deep. stops 
+// descending once room runs out, so it recurses no deeper than room
+//
+static int JsonEdit_within_depth(const JsonNode_t* node, unsigned long room) {
+    const JsonNode_t* iter;
+
+    switch(node->type) {
+    case JsonNodeType_object:
+        if(room == 0ul)
+            return 0;
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next)
+            if(iter->pair.value != NULL && !JsonEdit_within_depth(iter->pair.value, room - 1ul))
+                return 0;
+        return 1;
+    case JsonNodeType_array:
+        if(room == 0ul)
+            return 0;
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next)
+            if(iter->elem.item != NULL && !JsonEdit_within_depth(iter->elem.item, room - 1ul))
+                return 0;
+        return 1;
+    default:
+        return 1;
+    }
+}
+
+//
+// the parser never builds trees nested deeper than JSONPARSER_MAX_DEPTH and 
+// writing, copying, cloning and encoding recurse once per level, so edits 
+// keep every tree within that limit too
+//
+int JsonEdit_fits_depth(const JsonNode_t* parent, const JsonNode_t* value) {
+    if(value->type != JsonNodeType_object && value->type != JsonNodeType_array)
+        return 1;
+
+    unsigned long depth = 0ul;
+    for(; parent != NULL; parent = parent->parent)
+        if(parent->type == JsonNodeType_object || parent->type == JsonNodeType_array)
+            depth++;
+
+    return depth < JSONPARSER_MAX_DEPTH && JsonEdit_within_depth(value, JSONPARSER_MAX_DEPTH - depth);
+}
+
+JsonNode_t* JsonEdit_obj_append(JsonDocument_t* doc, JsonEditBuffer_t* buf, JsonNode_t* obj, const char* key, JsonNode_t* value) {
+    if(obj == NULL || obj->type != JsonNodeType_object || key == NULL || !JsonEdit_is_detached(doc, value) || 
+            !JsonEdit_fits_depth(obj, value))
+        return NULL;
+
+    const size_t key_len = strlen(key);
+
+    int ok;
+    const JsonOffset_t key_start = JsonEdit_store_text(buf, key, key_len, &ok);
+    if(!ok)
+        return NULL;
+
+    JsonNode_t* pair = JsonEdit_new_node(doc, JsonNodeType_pair);
+    if(pair == NULL) {
+        buf->len = key_start;
+        return NULL;
+    }
+
+    pair->flags  = JsonEdit_text_flags(key, key_len);
+    pair->parent = obj;
+    pair->pair.key_start = key_start;
+    pair->pair.key_end   = key_start + (JsonOffset_t)key_len;
+    pair->pair.value     = value;
+    value->parent = pair;
+
+    if(obj->obj.first == NULL) obj->obj.first = pair;
+    else                       obj->obj.last->pair.next = pair;
+    obj->obj.last = pair;
+    JsonEdit_touch(obj);
+    return pair;
+}
+
+JsonNode_t* JsonEdit_obj_set(JsonDocument_t* doc, JsonEditBuffer_t* buf, JsonNode_t* obj, const char* key, JsonNode_t* value) {
+    if(obj == NULL || obj->type != JsonNodeType_object || key == NULL || !JsonEdit_is_detached(doc, value))
+        return NULL;
+
+    JsonNode_t* pair = JsonObj_field_by_name(buf->data, obj, key);
+    if(pair == NULL)
+        return JsonEdit_obj_append(doc, buf, obj, key, value);
+
+    if(!JsonEdit_fits_depth(obj, value))
+        return NULL;
+
+    JsonNode_t* old_value = pair->pair.value;
+    pair->pair.value = value;
+    value->parent = pair;
+    JsonParser_release_document_nodes(doc, old_value);
+    JsonEdit_touch(obj);
+    return pair;
+}
+
+JsonNode_t* JsonEdit_arr_append(JsonDocument_t* doc, JsonNode_t* arr, JsonNode_t* value) {
+    if(arr == NULL || arr->type != JsonNodeType_array || !JsonEdit_is_detached(doc, value) || 
+            !JsonEdit_fits_depth(arr, value))
+        return NULL;
+
+    JsonNode_t* elem = JsonEdit_new_element(doc, arr, value);
+    if(elem == NULL)
+        return NULL;
+
+    if(arr->arr.first == NULL) arr->arr.first = elem;
+    else                       arr->arr.last->elem.next = elem;
+    arr->arr.last = elem;
+    JsonEdit_touch(arr);
+    return elem;
+}
+
+JsonNode_t* JsonEdit_arr_insert(JsonDocument_t* doc, JsonNode_t* arr, size_t idx, JsonNode_t* value) {
+    if(arr == NULL || arr->type != JsonNodeType_array || !JsonEdit_is_detached(doc, value) || 
+            !JsonEdit_fits_depth(arr, value))
+        return NULL;
+
+    // find the element to insert after (NULL to insert at the front)
+    JsonNode_t* prev = NULL;
+    size_t i;
+    for(i = 0ul; i < idx; i++) {
+        prev = (prev == NULL) ? arr->arr.first : prev->elem.next;
+        if(prev == NULL)
+            return NULL; // past the end
+    }
+
+    JsonNode_t* elem = JsonEdit_new_element(doc, arr, value);
+    if(elem == NULL)
+        return NULL;
+
+    if(prev == NULL) {
+        elem->elem.next = arr->arr.first;
+        arr->arr.first  = elem;
+    } else {
+        elem->elem.next = prev->elem.next;
+        prev->elem.next = elem;
+    }
+
+    if(elem->elem.next == NULL)
+        arr->arr.last = elem;
+    JsonEdit_touch(arr);
+    return elem;
+}
+
+//
+// the element of arr that is or holds item, and the one before it
+//
+static JsonNode_t* JsonEdit_find_element(JsonNode_t* arr, const JsonNode_t* item, JsonNode_t** prev) {
+    JsonNode_t* elem;
+    *prev = NULL;
+    for(elem = arr->arr.first; elem != NULL; elem = elem->elem.next) {
+        if(elem == item || elem->elem.item == item)
+            return elem;
+        *prev = elem;
+    }
+    return NULL;
+}
+
+int JsonEdit_replace(JsonDocument_t* doc, JsonNode_t* old_value, JsonNode_t* value) {
+    if(old_value == NULL || old_value == value || !JsonEdit_is_detached(doc, value))
+        return 0;
+
+    JsonNode_t* parent = old_value->parent;
+    if(!JsonEdit_fits_depth(parent, value))
+        return 0;
+
+    if(parent == NULL) {
+        if(old_value != doc->first)
+            return 0;
+        doc->first = value;
+    } else if(parent->type == JsonNodeType_pair) {
+        parent->pair.value = value;
+    } else if(parent->type == JsonNodeType_array) {
+        JsonNode_t* prev;
+        JsonNode_t* elem = JsonEdit_find_element(parent, old_value, &prev);
+        if(elem == NULL)
+            return 0;
+        elem->elem.item = value;
+    } else {
+        return 0;
+    }
+
+    value->parent = parent;
+    JsonParser_release_document_nodes(doc, old_value);
+    JsonEdit_touch(parent);
+    return 1;
+}
+
+int JsonEdit_remove(JsonDocument_t* doc, JsonNode_t* node) {
+    if(node == NULL)
+        return 0;
+
+    if(node->type != JsonNodeType_pair && node->parent != NULL && node->parent->type == JsonNodeType_pair)
+        node = node->parent; // remove the field holding the value
+
+    JsonNode_t* parent = node->parent;
+    if(parent == NULL)
+        return 0;
+
+    if(node->type == JsonNodeType_pair) {
+        if(parent->type != JsonNodeType_object)
+            return 0;
+
+        JsonNode_t* prev = NULL;
+        JsonNode_t* pair;
+        for(pair = parent->obj.first; pair != NULL && pair != node; pair = pair->pair.next)
+            prev = pair;
+        if(pair == NULL)
+            return 0;
+
+        if(prev == NULL) parent->obj.first = node->pair.next;
+        else             prev->pair.next   = node->pair.next;
+        if(parent->obj.last == node)
+            parent->obj.last = prev;
+
+        JsonParser_release_document_nodes(doc, node);
+        JsonEdit_touch(parent);
+        return 1;
+    }
+
+    if(parent->type != JsonNodeType_array)
+        return 0;
+
+    JsonNode_t* prev;
+    JsonNode_t* elem = JsonEdit_find_element(parent, node, &prev);
+    if(elem == NULL)
+        return 0;
+
+    if(prev == NULL) parent->arr.first = elem->elem.next;
+    else             prev->elem.next   = elem->elem.next;
+    if(parent->arr.last == elem)
+        parent->arr.last = prev;
+
+    JsonParser_release_document_nodes(doc, elem);
+    JsonEdit_touch(parent);
+    return 1;
+}
+
+JsonNode_t* JsonEdit_detach(JsonDocument_t* doc, JsonNode_t* value) {
+    if(value == NULL || value->type == JsonNodeType_pair || value->type == JsonNodeType_element)
+        return NULL;
+
+    JsonNode_t* holder = value->parent;
+    if(holder == NULL)
+        return NULL;
+
+    // unhook value so removing its holder leaves it alone
+    if(holder->type == JsonNodeType_pair) {
+        holder->pair.value = NULL;
+        if(!JsonEdit_remove(doc, holder)) {
+            holder->pair.value = value;
+            return NULL;
+        }
+    } else {
+        JsonNode_t* prev;
+        JsonNode_t* elem = (holder->type == JsonNodeType_array) ? JsonEdit_find_element(holder, value, &prev) : NULL;
+        if(elem == NULL)
+            return NULL;
+        elem->elem.item = NULL;
+        if(!JsonEdit_remove(doc, elem)) {
+            elem->elem.item = value;
+            return NULL;
+        }
+    }
+
+    value->parent = NULL;
+    return value;
+}
+
+//
+// output position keeps counting past the end of dest so
+// the full length of the text is always known
+//
+typedef struct {
+    char* dest;
+    size_t dest_len;
+    size_t pos;
+} JsonEdit_writer_t;
+
+static inline void JsonEdit_put(JsonEdit_writer_t* w, const char c) {
+    if(w->pos < w->dest_len)
+        w->dest[w->pos] = c;
+    w->pos++;
+}
+
+static void JsonEdit_put_bytes(JsonEdit_writer_t* w, const char* src, size_t len) {
+    if(w->pos < w->dest_len) {
+        const size_t room = w->dest_len - w->pos;
+        memcpy(w->dest + w->pos, src, len < room ? len : room);
+    }
+    w->pos += len;
+}
+
+static void JsonEdit_put_string(JsonEdit_writer_t* w, const char* start, const char* end, unsigned int flags) {
+    JsonEdit_put(w, '"');
+
+    if(flags & JsonNodeFlag_escaped) { // still in its original escaped form
+        JsonEdit_put_bytes(w, start, (size_t)(end - start));
+        JsonEdit_put(w, '"');
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    const char* run = start; // bytes that need no escaping are copied in runs
+
+    for(; start < end; start++) {
+        const unsigned char c = (unsigned char)*start;
+        if(c >= 0x20u && c != '"' && c != '\\')
+            continue;
+
+        JsonEdit_put_bytes(w, run, (size_t)(start - run));
+        run = start + 1;
+
+        JsonEdit_put(w, '\\');
+        switch(c) {
+        case '"':  JsonEdit_put(w, '"'); break;
+        case '\\': JsonEdit_put(w, '\\'); break;
+        case '\b': JsonEdit_put(w, 'b'); break;
+        case '\f': JsonEdit_put(w, 'f'); break;
+        case '\n': JsonEdit_put(w, 'n'); break;
+        case '\r': JsonEdit_put(w, 'r'); break;
+        case '\t': JsonEdit_put(w, 't'); break;
+        default:
+            JsonEdit_put_bytes(w, "u00", 3ul);
+            JsonEdit_put(w, hex[c >> 4]);
+            JsonEdit_put(w, hex[c & 0x0fu]);
+            break;
+        }
+    }
+
+    JsonEdit_put_bytes(w, run, (size_t)(end - run));
+    JsonEdit_put(w, '"');
+}
+
+static void JsonEdit_write_node(JsonEdit_writer_t* w, const char* doc_source, const JsonNode_t* node) {
+    const JsonNode_t* iter;
+
+    switch(node->type) {
+    case JsonNodeType_object:
+        JsonEdit_put(w, '{');
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next) {
+            if(iter != node->obj.first)
+                JsonEdit_put(w, ',');
+            JsonEdit_put_string(w, doc_source + iter->pair.key_start, doc_source + iter->pair.key_end, iter->flags);
+            JsonEdit_put(w, ':');
+            if(iter->pair.value != NULL) JsonEdit_write_node(w, doc_source, iter->pair.value);
+            else                         JsonEdit_put_bytes(w, "null", 4ul);
+        }
+        JsonEdit_put(w, '}');
+        break;
+    case JsonNodeType_array:
+        JsonEdit_put(w, '[');
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next) {
+            if(iter != node->arr.first)
+                JsonEdit_put(w, ',');
+            if(iter->elem.item != NULL) JsonEdit_write_node(w, doc_source, iter->elem.item);
+            else                        JsonEdit_put_bytes(w, "null", 4ul);
+        }
+        JsonEdit_put(w, ']');
+        break;
+    case JsonNodeType_pair:
+        JsonEdit_put_string(w, doc_source + node->pair.key_start, doc_source + node->pair.key_end, node->flags);
+        JsonEdit_put(w, ':');
+        if(node->pair.value != NULL) JsonEdit_write_node(w, doc_source, node->pair.value);
+        else                         JsonEdit_put_bytes(w, "null", 4ul);
+        break;
+    case JsonNodeType_element:
+        if(node->elem.item != NULL) JsonEdit_write_node(w, doc_source, node->elem.item);
+        else                        JsonEdit_put_bytes(w, "null", 4ul);
+        break;
+    case JsonNodeType_string:
+        JsonEdit_put_string(w, doc_source + node->str.start, doc_source + node->str.end, node->flags);
+        break;
+    case JsonNodeType_number:
+        JsonEdit_put_bytes(w, doc_source + node->num.start, (size_t)(node->num.end - node->num.start));
+        break;
+    case JsonNodeType_true:  JsonEdit_put_bytes(w, "true", 4ul); break;
+    case JsonNodeType_false: JsonEdit_put_bytes(w, "false", 5ul); break;
+    default:                 JsonEdit_put_bytes(w, "null", 4ul); break;
+    }
+}
+
+size_t JsonEdit_write(const char* doc_source, const JsonNode_t* node, char* dest, size_t dest_len) {
+    JsonEdit_writer_t w;
+    w.dest     = dest;
+    w.dest_len = dest_len;
+    w.pos      = 0ul;
+
+    if(doc_source != NULL && node != NULL)
+        JsonEdit_write_node(&w, doc_source, node);
+
+    if(w.pos < dest_len)      dest[w.pos] = '\0';
+    else if(dest_len > 0ul)   dest[dest_len - 1ul] = '\0';
+    return w.pos;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// editing parsed documents in place. new strings and numbers are written 
+// into the spare room of a JsonEditBuffer_t, which holds the source of the 
+// document followed by that room, so every node keeps addressing its text 
+// by offset from the same doc_source (buf->data). new nodes come from the 
+// document's allocator (see JsonParser_allocate_document_node) and removed 
+// nodes go back to the document for reuse.
+//
+// new values are created detached and become part of the tree when they 
+// are appended, inserted or used as a replacement. a value can only be 
+// linked into the tree once. as in parsed documents, containers can not be 
+// nested deeper than JSONPARSER_MAX_DEPTH, linking a value in fails if they 
+// would be. checking that walks the containers of the value
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct JsonEditBuffer {
+    char* data;  // doc_source of the edited document
+    size_t len;  // bytes in use, starting with the source itself
+    size_t size; // capacity of data
+} JsonEditBuffer_t;
+
+//
+// data holds the source of the document in its first len bytes. when the 
+// buffer runs out of room, functions writing text fail. data can then be 
+// moved into a larger buffer (for example with realloc) and size updated, 
+// offsets in the tree stay valid
+//
+void JsonEditBuffer_init(JsonEditBuffer_t* buf, char* data, size_t len, size_t size);
+
+//
+// create detached values. strings are stored as given (unescaped UTF-8, 
+// without quotes, like after JsonParser_parse_document_insitu) and are 
+// escaped again by JsonEdit_write. doubles must be finite.
+// returns NULL if the node or the text does not fit
+//
+JsonNode_t* JsonEdit_new_object(JsonDocument_t* doc);
+JsonNode_t* JsonEdit_new_array(JsonDocument_t* doc);
+JsonNode_t* JsonEdit_new_literal(JsonDocument_t* doc, JsonNodeType_t type); // true, false or null
+JsonNode_t* JsonEdit_new_string(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* str, size_t len);
+JsonNode_t* JsonEdit_new_int64(JsonDocument_t* doc, JsonEditBuffer_t* buf, int64_t value);
+JsonNode_t* JsonEdit_new_double(JsonDocument_t* doc, JsonEditBuffer_t* buf, double value);
+
+//
+// create a detached copy of the tree under src, which may belong to 
+// another document or to this one (src_source may be buf->data). the 
+// text of strings, keys and numbers is copied as it is, escapes and all.
+// returns NULL and takes nothing from buf if the copy does not fit
+//
+JsonNode_t* JsonEdit_copy(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* src_source, const JsonNode_t* src);
+
+//
+// add a field to the end of obj in O(1), without checking for an existing 
+// field of the same name. returns the new pair or NULL on failure
+//
+JsonNode_t* JsonEdit_obj_append(JsonDocument_t* doc, JsonEditBuffer_t* buf, JsonNode_t* obj, const char* key, JsonNode_t* value);
+
+//
+// replace the value of the first field named key (compared like 
+// JsonObj_field_by_name), or append a new field if there is none.
+// returns the pair holding value or NULL on failure
+//
+JsonNode_t* JsonEdit_obj_set(JsonDocument_t* doc, JsonEditBuffer_t* buf, JsonNode_t* obj, const char* key, JsonNode_t* value);
+
+//
+// add value to the end of arr in O(1). returns the new element or NULL on failure
+//
+JsonNode_t* JsonEdit_arr_append(JsonDocument_t* doc, JsonNode_t* arr, JsonNode_t* value);
+
+//
+// insert value so it becomes element idx of arr, idx may be the length 
+// of arr. returns the new element or NULL on failure
+//
+JsonNode_t* JsonEdit_arr_insert(JsonDocument_t* doc, JsonNode_t* arr, size_t idx, JsonNode_t* value);
+
+//
+// put value where old_value is in the tree and release old_value and 
+// everything below it. old_value may be the root of the document.
+// items of arrays are found by walking the array.
+// returns 1 on success, else 0
+//
+int JsonEdit_replace(JsonDocument_t* doc, JsonNode_t* old_value, JsonNode_t* value);
+
+//
+// remove a pair from its object, or a value from the pair or array holding 
+// it, and release everything below it. the root cannot be removed.
+// fields and items are found by walking their container.
+// returns 1 on success, else 0
+//
+int JsonEdit_remove(JsonDocument_t* doc, JsonNode_t* node);
+
+//
+// take a value out of the pair or array holding it without releasing it, 
+// so it can be linked in somewhere else. the pair or element that held 
+// it is released. the root cannot be detached.
+// returns the detached value or NULL on failure
+//
+JsonNode_t* JsonEdit_detach(JsonDocument_t* doc, JsonNode_t* value);
+
+//
+// checks that value can be linked in below parent (a container, a pair, 
+// or NULL for the root) without nesting containers deeper than 
+// JSONPARSER_MAX_DEPTH. returns 1 if it can, else 0
+//
+int JsonEdit_fits_depth(const JsonNode_t* parent, const JsonNode_t* value);
+
+//
+// write the tree under node as compact JSON text. strings and keys that 
+// are not marked JsonNodeFlag_escaped are escaped as needed, the rest of 
+// the text is copied as it is. like snprintf, returns the length of the 
+// whole text and writes at most dest_len bytes including a null terminator
+//
+size_t JsonEdit_write(const char* doc_source, const JsonNode_t* node, char* dest, size_t dest_len);
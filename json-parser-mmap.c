@@ -0,0 +1,86 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, madvise
+
+#include "json-parser-mmap.h"
+#include "json-parser-config.h"
+
+#ifdef JSONPARSER_HAS_MMAP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int JsonMappedFile_open(JsonMappedFile_t* mf, const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0)
+        return 0;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t size      = (size_t)st.st_size;
+    const size_t map_size  = ((size + 1ul + page_size - 1ul) / page_size) * page_size;
+
+    //
+    // reserve zeroed anonymous memory for the file plus at least one 
+    // byte of terminator, then map the file over the front of it. the 
+    // tail of the last file page and any page after it read as zero
+    //
+    char* base = (char*)mmap(NULL, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+
+    if(size > 0ul) {
+        void* file_map = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if(file_map == MAP_FAILED) {
+            munmap(base, map_size);
+            close(fd);
+            return 0;
+        }
+
+        // hints only, failures are not important
+        (void)madvise(base, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        (void)madvise(base, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    close(fd); // the mapping keeps its own reference to the file
+
+    mf->data     = base;
+    mf->size     = size;
+    mf->map_size = map_size;
+    return 1;
+}
+
+void JsonMappedFile_close(JsonMappedFile_t* mf) {
+    if(mf->data == NULL)
+        return;
+
+    munmap((void*)mf->data, mf->map_size);
+    mf->data     = NULL;
+    mf->size     = 0ul;
+    mf->map_size = 0ul;
+}
+
+#endif // JSONPARSER_HAS_MMAP
@@ -0,0 +1,50 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// memory-mapped loading of JSON files (POSIX only).
+// documents can be parsed directly out of the mapping, 
+// the file contents are never copied into the heap
+//
+
+#include "json-parser-config.h"
+
+#include <stddef.h>
+
+#ifdef JSONPARSER_HAS_MMAP
+
+typedef struct JsonMappedFile {
+    const char* data; // contents of the file, always followed by a null terminator
+    size_t size;      // size of the file in bytes, not including the terminator
+    size_t map_size;  // size of the whole mapping
+} JsonMappedFile_t;
+
+//
+// map the given file read-only. the mapping is padded with zeroed 
+// memory so data is null-terminated and can be handed directly to 
+// JsonParser_parse_document. the kernel is advised that the mapping 
+// will be read sequentially (and may be backed by huge pages)
+// returns 1 on success, else 0
+//
+int JsonMappedFile_open(JsonMappedFile_t* mf, const char* filename);
+
+//
+// unmap a file previously mapped with JsonMappedFile_open. 
+// any document parsed from it must not be used afterwards
+//
+void JsonMappedFile_close(JsonMappedFile_t* mf);
+
+#endif // JSONPARSER_HAS_MMAP
@@ -0,0 +1,462 @@
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "json-parser-patch.h"
+#include "json-parser-util.h"
+
+#include <string.h>
+
+const char* JsonPatchCode_as_string(JsonPatchCode_t c) {
+    switch(c) {
+    case JsonPatchCode_success:            return "success";
+    case JsonPatchCode_malformed_patch:    return "malformed patch";
+    case JsonPatchCode_path_not_found:     return "path not found";
+    case JsonPatchCode_test_failed:        return "test failed";
+    case JsonPatchCode_allocation_failure: return "allocation failure";
+    case JsonPatchCode_too_deep:           return "nested too deep";
+    default:                               return "unknown patch code";
+    }
+}
+
+//
+// unescaped text of a string, null-terminated, at the end of the spare 
+// room of buf. buf->size is lowered so the editing functions cannot write 
+// over it, callers restore it once they are done with the text
+//
+static char* JsonPatch_scratch_text(JsonEditBuffer_t* buf, const char* source, JsonOffset_t start, JsonOffset_t end, unsigned int flags, size_t* len) {
+    const size_t size = (size_t)(end - start) + 1ul; // unescaping never makes text longer
+    if(buf->len > buf->size || size > buf->size - buf->len)
+        return NULL;
+
+    JsonString_t str;
+    str.doc_source = source;
+    str.start      = start;
+    str.end        = end;
+    str.flags      = flags;
+
+    char* text = buf->data + buf->size - size;
+    *len = JsonString_copy_utf8(&str, text);
+    text[*len] = '\0';
+    buf->size -= size;
+    return text;
+}
+
+//
+// compares the key of pair, unescaped, to key
+//
+static int JsonPatch_key_is(const char* doc_source, const JsonNode_t* pair, const char* key, size_t key_len) {
+    const char* src = doc_source + pair->pair.key_start;
+    const char* end = doc_source + pair->pair.key_end;
+
+    if(!(pair->flags & JsonNodeFlag_escaped))
+        return (size_t)(end - src) == key_len && memcmp(src, key, key_len) == 0;
+
+    size_t pos = 0ul;
+    while(src != end) {
+        if(*src == '\\') {
+            char decoded[8];
+            size_t n = 0ul;
+            src = JsonParser_decode_escape(src, end, decoded, &n);
+            if(n > key_len - pos || memcmp(decoded, key + pos, n) != 0)
+                return 0;
+            pos += n;
+        } else {
+            if(pos == key_len || *src != key[pos])
+                return 0;
+            src++;
+            pos++;
+        }
+    }
+    return pos == key_len;
+}
+
+static JsonNode_t* JsonPatch_find_field(const char* doc_source, JsonNode_t* obj, const char* key, size_t key_len) {
+    JsonNode_t* pair;
+    for(pair = obj->obj.first; pair != NULL; pair = pair->pair.next)
+        if(JsonPatch_key_is(doc_source, pair, key, key_len))
+            return pair;
+    return NULL;
+}
+
+//
+// array index in a path: decimal digits without leading zeros
+//
+static int JsonPatch_token_index(const char* token, size_t len, size_t* idx) {
+    if(len == 0ul || (token[0] == '0' && len > 1ul))
+        return 0;
+
+    size_t i;
+    *idx = 0ul;
+    for(i = 0ul; i < len; i++) {
+        if(token[i] < '0' || token[i] > '9' || *idx > ((size_t)-1 - 9ul) / 10ul)
+            return 0;
+        *idx = *idx * 10ul + (size_t)(token[i] - '0');
+    }
+    return 1;
+}
+
+//
+// the value under node named by a path token, or NULL
+//
+static JsonNode_t* JsonPatch_child(const char* doc_source, JsonNode_t* node, const char* token, size_t len) {
+    if(node->type == JsonNodeType_object) {
+        JsonNode_t* pair = JsonPatch_find_field(doc_source, node, token, len);
+        return pair ? pair->pair.value : NULL;
+    }
+
+    size_t idx;
+    if(node->type == JsonNodeType_array && JsonPatch_token_index(token, len, &idx))
+        return JsonArr_index(node, idx);
+    return NULL;
+}
+
+//
+// path points at the '/' in front of a token. unescapes ~0 and ~1 in 
+// the token in place and moves path to the '/' or null after it
+//
+static int JsonPatch_next_token(char** path, char** token, size_t* len) {
+    char* src = *path + 1;
+    char* dest = src;
+    *token = src;
+
+    while(*src != '/' && *src != '\0') {
+        if(*src == '~') {
+            if(src[1] == '0')      *dest++ = '~';
+            else if(src[1] == '1') *dest++ = '/';
+            else                   return 0;
+            src += 2;
+        } else {
+            *dest++ = *src++;
+        }
+    }
+
+    *len  = (size_t)(dest - *token);
+    *path = src;
+    return 1;
+}
+
+//
+// follow path (as written in the patch) to the container holding the 
+// value it names, which is the last token. parent is NULL for the root
+//
+static JsonPatchCode_t JsonPatch_resolve(JsonDocument_t* doc, const char* doc_source, char* path, JsonNode_t** parent, char** token, size_t* len) {
+    *parent = NULL;
+    *token  = NULL;
+    *len    = 0ul;
+
+    if(*path == '\0')
+        return JsonPatchCode_success;
+    if(*path != '/')
+        return JsonPatchCode_malformed_patch;
+
+    JsonNode_t* node = doc->first;
+    for(;;) {
+        if(node == NULL || (node->type != JsonNodeType_object && node->type != JsonNodeType_array))
+            return JsonPatchCode_path_not_found;
+        if(!JsonPatch_next_token(&path, token, len))
+            return JsonPatchCode_malformed_patch;
+        if(*path == '\0')
+            break;
+        node = JsonPatch_child(doc_source, node, *token, *len);
+    }
+
+    (*token)[*len] = '\0'; // the last token ends the path
+    *parent = node;
+    return JsonPatchCode_success;
+}
+
+static JsonPatchCode_t JsonPatch_find(JsonDocument_t* doc, const char* doc_source, char* path, JsonNode_t** node) {
+    JsonNode_t* parent;
+    char* token;
+    size_t len;
+
+    const JsonPatchCode_t code = JsonPatch_resolve(doc, doc_source, path, &parent, &token, &len);
+    if(code != JsonPatchCode_success)
+        return code;
+
+    *node = (parent == NULL) ? doc->first : JsonPatch_child(doc_source, parent, token, len);
+    return (*node != NULL) ? JsonPatchCode_success : JsonPatchCode_path_not_found;
+}
+
+//
+// why value could not be linked in below parent, which failed to allocate 
+// or would have nested too deep. value is released
+//
+static JsonPatchCode_t JsonPatch_link_failed(JsonDocument_t* doc, const JsonNode_t* parent, JsonNode_t* value) {
+    const JsonPatchCode_t code = JsonEdit_fits_depth(parent, value) ? JsonPatchCode_allocation_failure : JsonPatchCode_too_deep;
+    JsonParser_release_document_nodes(doc, value);
+    return code;
+}
+
+//
+// link the detached value into doc at path. value is released if it 
+// cannot be added
+//
+static JsonPatchCode_t JsonPatch_add(JsonDocument_t* doc, JsonEditBuffer_t* buf, char* path, JsonNode_t* value) {
+    JsonNode_t* parent;
+    char* token;
+    size_t len;
+
+    JsonPatchCode_t code = JsonPatch_resolve(doc, buf->data, path, &parent, &token, &len);
+    if(code != JsonPatchCode_success) {
+        JsonParser_release_document_nodes(doc, value);
+        return code;
+    }
+
+    if(parent == NULL) { // the whole document
+        if(doc->first == NULL) doc->first = value;
+        else if(!JsonEdit_replace(doc, doc->first, value))
+            return JsonPatch_link_failed(doc, NULL, value);
+        return JsonPatchCode_success;
+    }
+
+    if(parent->type == JsonNodeType_object) {
+        JsonNode_t* pair = JsonPatch_find_field(buf->data, parent, token, len);
+        if(pair != NULL) {
+            if(!JsonEdit_replace(doc, pair->pair.value, value))
+                return JsonPatch_link_failed(doc, parent, value);
+            return JsonPatchCode_success;
+        }
+        if(JsonEdit_obj_append(doc, buf, parent, token, value) != NULL)
+            return JsonPatchCode_success;
+        return JsonPatch_link_failed(doc, parent, value);
+    } else if(len == 1ul && token[0] == '-') {
+        if(JsonEdit_arr_append(doc, parent, value) != NULL)
+            return JsonPatchCode_success;
+        return JsonPatch_link_failed(doc, parent, value);
+    } else {
+        size_t idx;
+        if(!JsonPatch_token_index(token, len, &idx))
+            code = JsonPatchCode_path_not_found;
+        else if(JsonEdit_arr_insert(doc, parent, idx, value) != NULL)
+            return JsonPatchCode_success;
+        else if(idx == 0ul || JsonArr_index(parent, idx - 1ul) != NULL) // only walk the array again to tell why
+            return JsonPatch_link_failed(doc, parent, value);
+        else
+            code = JsonPatchCode_path_not_found;
+    }
+
+    JsonParser_release_document_nodes(doc, value);
+    return code;
+}
+
+//
+// the unescaped text of a string member of an operation, kept in the 
+// scratch space of buf
+//
+static JsonPatchCode_t JsonPatch_op_text(JsonEditBuffer_t* buf, const char* patch_source, const JsonNode_t* op, const char* name, char** text) {
+    const JsonNode_t* pair = JsonObj_field_by_name(patch_source, (JsonNode_t*)op, name);
+    if(pair == NULL || pair->pair.value->type != JsonNodeType_string)
+        return JsonPatchCode_malformed_patch;
+
+    const JsonNode_t* str = pair->pair.value;
+    size_t len;
+    *text = JsonPatch_scratch_text(buf, patch_source, str->str.start, str->str.end, str->flags, &len);
+    return (*text != NULL) ? JsonPatchCode_success : JsonPatchCode_allocation_failure;
+}
+
+static JsonPatchCode_t JsonPatch_apply_op(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* patch_source, const JsonNode_t* op) {
+    if(op->type != JsonNodeType_object)
+        return JsonPatchCode_malformed_patch;
+
+    const JsonNode_t* name = JsonObj_field_by_name(patch_source, (JsonNode_t*)op, "op");
+    if(name == NULL || name->pair.value->type != JsonNodeType_string)
+        return JsonPatchCode_malformed_patch;
+    name = name->pair.value;
+
+    const char* op_name = patch_source + name->str.start;
+    const size_t op_len = (size_t)(name->str.end - name->str.start);
+#define JSONPATCH_OP_IS(s) (op_len == sizeof(s) - 1ul && memcmp(op_name, s, op_len) == 0)
+
+    const JsonNode_t* value = NULL;
+    if(JSONPATCH_OP_IS("add") || JSONPATCH_OP_IS("replace") || JSONPATCH_OP_IS("test")) {
+        const JsonNode_t* pair = JsonObj_field_by_name(patch_source, (JsonNode_t*)op, "value");
+        if(pair == NULL)
+            return JsonPatchCode_malformed_patch;
+        value = pair->pair.value;
+    }
+
+    char* from = NULL;
+    JsonPatchCode_t code;
+    if(JSONPATCH_OP_IS("move") || JSONPATCH_OP_IS("copy")) {
+        code = JsonPatch_op_text(buf, patch_source, op, "from", &from);
+        if(code != JsonPatchCode_success)
+            return code;
+    }
+
+    char* path;
+    code = JsonPatch_op_text(buf, patch_source, op, "path", &path);
+    if(code != JsonPatchCode_success)
+        return code;
+
+    JsonNode_t* target;
+
+    if(JSONPATCH_OP_IS("add")) {
+        JsonNode_t* copy = JsonEdit_copy(doc, buf, patch_source, value);
+        if(copy == NULL)
+            return JsonPatchCode_allocation_failure;
+        return JsonPatch_add(doc, buf, path, copy);
+    }
+
+    if(JSONPATCH_OP_IS("remove")) {
+        code = JsonPatch_find(doc, buf->data, path, &target);
+        if(code != JsonPatchCode_success)
+            return code;
+        return JsonEdit_remove(doc, target) ? JsonPatchCode_success : JsonPatchCode_malformed_patch;
+    }
+
+    if(JSONPATCH_OP_IS("replace")) {
+        code = JsonPatch_find(doc, buf->data, path, &target);
+        if(code != JsonPatchCode_success)
+            return code;
+
+        JsonNode_t* copy = JsonEdit_copy(doc, buf, patch_source, value);
+        if(copy == NULL)
+            return JsonPatchCode_allocation_failure;
+        if(!JsonEdit_replace(doc, target, copy))
+            return JsonPatch_link_failed(doc, target->parent, copy);
+        return JsonPatchCode_success;
+    }
+
+    if(JSONPATCH_OP_IS("test")) {
+        code = JsonPatch_find(doc, buf->data, path, &target);
+        if(code != JsonPatchCode_success)
+            return code;
+        return JsonNode_equal(buf->data, target, patch_source, value, 1) ? JsonPatchCode_success : JsonPatchCode_test_failed;
+    }
+
+    if(JSONPATCH_OP_IS("move")) {
+        // a value cannot be moved into itself
+        const size_t from_len = strlen(from);
+        if(strncmp(path, from, from_len) == 0 && path[from_len] == '/')
+            return JsonPatchCode_malformed_patch;
+
+        const int same = (strcmp(path, from) == 0);
+        code = JsonPatch_find(doc, buf->data, from, &target);
+        if(code != JsonPatchCode_success || same)
+            return code;
+
+        JsonNode_t* moved = JsonEdit_detach(doc, target);
+        if(moved == NULL)
+            return JsonPatchCode_malformed_patch; // the root
+        return JsonPatch_add(doc, buf, path, moved);
+    }
+
+    if(JSONPATCH_OP_IS("copy")) {
+        code = JsonPatch_find(doc, buf->data, from, &target);
+        if(code != JsonPatchCode_success)
+            return code;
+
+        JsonNode_t* copy = JsonEdit_copy(doc, buf, buf->data, target);
+        if(copy == NULL)
+            return JsonPatchCode_allocation_failure;
+        return JsonPatch_add(doc, buf, path, copy);
+    }
+
+#undef JSONPATCH_OP_IS
+    return JsonPatchCode_malformed_patch;
+}
+
+JsonPatchCode_t JsonPatch_apply(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* patch_source, const JsonNode_t* patch) {
+    if(patch == NULL || patch->type != JsonNodeType_array)
+        return JsonPatchCode_malformed_patch;
+
+    const JsonNode_t* elem;
+    for(elem = patch->arr.first; elem != NULL; elem = elem->elem.next) {
+        const size_t size = buf->size;
+        const JsonPatchCode_t code = JsonPatch_apply_op(doc, buf, patch_source, elem->elem.item);
+        buf->size = size; // drop the scratch text
+        if(code != JsonPatchCode_success)
+            return code;
+    }
+    return JsonPatchCode_success;
+}
+
+//
+// merge patch into target, which is linked into the tree
+//
+static JsonPatchCode_t JsonPatch_merge_value(JsonDocument_t* doc, JsonEditBuffer_t* buf, JsonNode_t* target, const char* patch_source, const JsonNode_t* patch) {
+    if(patch->type != JsonNodeType_object) {
+        JsonNode_t* copy = JsonEdit_copy(doc, buf, patch_source, patch);
+        if(copy == NULL)
+            return JsonPatchCode_allocation_failure;
+        if(!JsonEdit_replace(doc, target, copy))
+            return JsonPatch_link_failed(doc, target->parent, copy);
+        return JsonPatchCode_success;
+    }
+
+    if(target->type != JsonNodeType_object) {
+        JsonNode_t* obj = JsonEdit_new_object(doc);
+        if(obj == NULL)
+            return JsonPatchCode_allocation_failure;
+        if(!JsonEdit_replace(doc, target, obj))
+            return JsonPatch_link_failed(doc, target->parent, obj);
+        target = obj;
+    }
+
+    const JsonNode_t* member;
+    for(member = patch->obj.first; member != NULL; member = member->pair.next) {
+        const JsonNode_t* value = member->pair.value;
+        const size_t size = buf->size;
+
+        size_t len;
+        const char* key = JsonPatch_scratch_text(buf, patch_source, member->pair.key_start, member->pair.key_end, member->flags, &len);
+        if(key == NULL)
+            return JsonPatchCode_allocation_failure;
+
+        JsonNode_t* field = JsonPatch_find_field(buf->data, target, key, len);
+        JsonNode_t* next_target = NULL;
+
+        if(value->type == JsonNodeType_null) {
+            if(field != NULL)
+                JsonEdit_remove(doc, field);
+        } else if(field != NULL) {
+            next_target = field->pair.value;
+        } else {
+            // merging into a missing member starts from nothing
+            JsonNode_t* node = (value->type == JsonNodeType_object) ? JsonEdit_new_object(doc) : JsonEdit_copy(doc, buf, patch_source, value);
+            if(node == NULL) {
+                buf->size = size;
+                return JsonPatchCode_allocation_failure;
+            }
+            if(JsonEdit_obj_append(doc, buf, target, key, node) == NULL) {
+                buf->size = size;
+                return JsonPatch_link_failed(doc, target, node);
+            }
+            if(value->type == JsonNodeType_object)
+                next_target = node;
+        }
+
+        buf->size = size;
+
+        if(next_target != NULL) {
+            const JsonPatchCode_t code = JsonPatch_merge_value(doc, buf, next_target, patch_source, value);
+            if(code != JsonPatchCode_success)
+                return code;
+        }
+    }
+    return JsonPatchCode_success;
+}
+
+JsonPatchCode_t JsonPatch_merge(JsonDocument_t* doc, JsonEditBuffer_t* buf, const char* patch_source, const JsonNode_t* patch) {
+    if(patch == NULL)
+        return JsonPatchCode_malformed_patch;
+
+    if(doc->first == NULL) {
+        doc->first = JsonEdit_new_literal(doc, JsonNodeType_null);
+        if(doc->first == NULL)
+            return JsonPatchCode_allocation_failure;
+    }
+    return JsonPatch_merge_value(doc, buf, doc->first, patch_source, patch);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+Copyright (C) 2022  Joe Cluett
+This file is part of json-parser.
+
+json-parser is free software: you can redistribute it and/or modify it under 
+the terms of the GNU General Public License as published by the 
+Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+json-parser is distributed in the hope that it will be useful, but WITHOUT 
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along 
+with json-parser. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+//
+// JSON Patch (RFC 6902) and JSON Merge Patch (RFC 7396) applied to a 
+// parsed document in place, through the editing functions in 
+// json-parser-edit.h. paths are resolved by walking the tree, so a patch 
+// costs about as much as looking up its paths plus copying the values it 
+// adds. values are copied out of the patch document, which is left alone.
+//
+// patches are not atomic. when an operation fails, the ones before it 
+// stay applied, so keep a copy (see JsonParser_clone_document) of any 
+// document that has to survive a failed patch unchanged
+//
+
+#include "json-parser.h"
+#include "json-parser-config.h"
+#include "json-parser-edit.h"
+
+#include <stddef.h>
+
+typedef enum {
+    JsonPatchCode_success = 0,
+
+    JsonPatchCode_malformed_patch,    // not a list of operations, or one is missing a member or has a bad path
+    JsonPatchCode_path_not_found,     // a path or from does not lead to a value
+    JsonPatchCode_test_failed,        // a test operation found a different value
+    JsonPatchCode_allocation_failure, // no node could be allocated or buf is full
+    JsonPatchCode_too_deep,           // the result would nest deeper than JSONPARSER_MAX_DEPTH
+} JsonPatchCode_t;
+
+//
+// get printable string for patch code
+//
+const char* JsonPatchCode_as_string(JsonPatchCode_t c);
+
+//
+// apply a JSON Patch (an array of operation objects) to doc, whose 
+// source is in buf. member names inside paths are compared after 
+// unescaping, and test compares values like JsonNode_equal ignoring the 
+// order of keys. the end of buf is used as scratch space while the 
+// paths are decoded, so it needs room for the longest path besides the 
+// text being added. removing the root is reported as malformed_patch
+//
+JsonPatchCode_t JsonPatch_apply(
+        JsonDocument_t* doc,
+        JsonEditBuffer_t* buf,
+        const char* patch_source,
+        const JsonNode_t* patch);
+
+//
+// apply a JSON Merge Patch to doc: members of patch objects are merged 
+// into objects of doc recursively, null members remove what they name 
+// and any other value replaces what is there. buf is used as in 
+// JsonPatch_apply
+//
+JsonPatchCode_t JsonPatch_merge(
+        JsonDocument_t* doc,
+        JsonEditBuffer_t* buf,
+        const char* patch_source,
+        const JsonNode_t* patch);
@@ -22,7 +22,7 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 
 static int JsonAPI_string_eq(const char* start, const char* end, const char* nt_cstr);
 
-int JsonString_init(JsonString_t* str, const char* doc_source, JsonNode_t* str_node) {
+int JsonString_init(JsonString_t* str, const char* doc_source, const JsonNode_t* str_node) {
 
     if(str == NULL || doc_source == NULL || str_node->type != JsonNodeType_string)
         return 0;
@@ -30,6 +30,7 @@ int JsonString_init(JsonString_t* str, const char* doc_source, JsonNode_t* str_n
     str->doc_source = doc_source;
     str->start      = str_node->str.start;
     str->end        = str_node->str.end;
+    str->flags      = str_node->flags;
     return 1;
 }
 
@@ -129,7 +130,7 @@ size_t JsonString_copy(const JsonString_t* str, char* restrict dest) {
                 dest++;
                 start++;
             }
-        } else if(start[0] == '\\') {
+        } else if(start[0] == '\\' && (str->flags & JsonNodeFlag_escaped)) {
             size_t l = JsonAPI_handle_escape_char(start[1], dest);
             dest += l;
             start += 2;
@@ -147,7 +148,7 @@ size_t JsonString_copy(const JsonString_t* str, char* restrict dest) {
 #endif
         }
 #else
-        if(start[0] == '\\') {
+        if(start[0] == '\\' && (str->flags & JsonNodeFlag_escaped)) {
             size_t l = JsonAPI_handle_escape_char(start[1], dest);
             dest += l;
             start += 2;
@@ -171,12 +172,52 @@ size_t JsonString_copy(const JsonString_t* str, char* restrict dest) {
     return (size_t)(dest - dest_start);
 }
 
-unsigned long JsonString_size(JsonString_t* str) {
+const char* JsonString_view(const JsonString_t* str, char* restrict scratch, size_t* len) {
+    if((str->flags & (JsonNodeFlag_escaped | JsonNodeFlag_non_ascii)) == 0u) {
+        *len = (size_t)(str->end - str->start);
+        return str->doc_source + str->start;
+    }
+
+    *len = JsonString_copy(str, scratch);
+    return scratch;
+}
+
+size_t JsonString_copy_utf8(const JsonString_t* str, char* restrict dest) {
+
+    const char* start = str->doc_source + str->start;
+    const char* end   = str->doc_source + str->end;
+
+    if(!(str->flags & JsonNodeFlag_escaped)) {
+        memcpy(dest, start, (size_t)(end - start));
+        return (size_t)(end - start);
+    }
+
+    size_t len = 0ul;
+
+    while(start < end) {
+        // copy everything up to the next escape sequence in one go
+        const char* esc = (const char*)memchr(start, '\\', (size_t)(end - start));
+        if(esc == NULL) 
+            esc = end;
+
+        memcpy(dest + len, start, (size_t)(esc - start));
+        len += (size_t)(esc - start);
+
+        if(esc == end)
+            break;
+
+        start = JsonParser_decode_escape(esc, end, dest + len, &len);
+    }
+
+    return len;
+}
+
+unsigned long JsonString_size(const JsonString_t* str) {
     return (unsigned long)(str->end - str->start);
 }
 
 int JsonArrIter_init(JsonArrIter_t* iter, JsonNode_t* arr) {
-    if(iter == NULL || arr == NULL | arr->type != JsonNodeType_array)
+    if(iter == NULL || arr == NULL || arr->type != JsonNodeType_array)
         return 0;
 
     iter->arr = arr;
@@ -192,14 +233,14 @@ int JsonArrIter_next(JsonArrIter_t* iter) {
     return (iter->element == NULL ? 0 : 1);
 }
 
-JsonNode_t* JsonArrIter_current(JsonArrIter_t* iter) {
+JsonNode_t* JsonArrIter_current(const JsonArrIter_t* iter) {
     if(iter->element == NULL)
         return NULL;
     return iter->element->elem.item;
 }
 
-int JsonObjIter_field_name_matches(JsonObjIter_t* iter, const char* doc_source, const char* fieldname) {
-    JsonNode_t* pair = JsonObjIter_current(iter);
+int JsonObjIter_field_name_matches(const JsonObjIter_t* iter, const char* doc_source, const char* fieldname) {
+    const JsonNode_t* pair = iter->current;
 
     if(pair == NULL)
         return 0;
@@ -224,17 +265,22 @@ JsonNode_t* JsonObj_field_by_name(const char* doc_source, JsonNode_t* obj, const
     return NULL;
 }
 
+JsonNode_t* JsonObj_first_field(JsonNode_t* obj) {
+    return (obj != NULL && obj->type == JsonNodeType_object ? obj->obj.first : NULL);
+}
+
 JsonNode_t* JsonPair_field(JsonNode_t* pair) {
     return (pair->type == JsonNodeType_pair ? pair->pair.value : NULL);
 }
 
-int JsonPair_key(JsonNode_t* pair, const char* doc_source, JsonString_t* str) {
+int JsonPair_key(const JsonNode_t* pair, const char* doc_source, JsonString_t* str) {
     if(pair->type != JsonNodeType_pair)
         return 0;
     
     str->doc_source = doc_source;
     str->start = pair->pair.key_start;
     str->end   = pair->pair.key_end;
+    str->flags = pair->flags;
     return 1;
 }
 
@@ -256,6 +302,113 @@ JsonNode_t* JsonArr_index(JsonNode_t* arr, size_t idx) {
     return JsonArrIter_current(&iter);
 }
 
+//
+// FNV-1a over the raw key bytes. keys are compared without decoding 
+// escape sequences, same as JsonObj_field_by_name
+//
+static inline size_t JsonAPI_hash_range(const char* start, const char* end) {
+    size_t h = (size_t)2166136261u;
+    while(start != end)
+        h = (h ^ (unsigned char)*start++) * (size_t)16777619u;
+    return h;
+}
+
+static inline size_t JsonAPI_hash_cstr(const char* str) {
+    size_t h = (size_t)2166136261u;
+    while(*str)
+        h = (h ^ (unsigned char)*str++) * (size_t)16777619u;
+    return h;
+}
+
+size_t JsonObjIndex_slots_needed(const JsonNode_t* obj) {
+    if(obj == NULL || obj->type != JsonNodeType_object)
+        return 0ul;
+
+    size_t fields = 0ul;
+    const JsonNode_t* pair;
+    for(pair = obj->obj.first; pair != NULL; pair = pair->pair.next)
+        fields++;
+
+    // keep the load factor at or below one half
+    size_t slots = 2ul;
+    while(slots < fields * 2ul)
+        slots *= 2ul;
+    return slots;
+}
+
+int JsonObjIndex_init(JsonObjIndex_t* index, const char* doc_source, JsonNode_t* obj, JsonNode_t** slots, size_t num_slots) {
+    if(index == NULL || doc_source == NULL || obj == NULL || obj->type != JsonNodeType_object || slots == NULL)
+        return 0;
+
+    if(num_slots == 0ul || (num_slots & (num_slots - 1ul)) != 0ul)
+        return 0;
+
+    size_t i;
+    for(i = 0ul; i < num_slots; i++)
+        slots[i] = NULL;
+
+    const size_t mask = num_slots - 1ul;
+    size_t used = 0ul;
+
+    JsonNode_t* pair;
+    for(pair = obj->obj.first; pair != NULL; pair = pair->pair.next) {
+        const char* key     = doc_source + pair->pair.key_start;
+        const char* key_end = doc_source + pair->pair.key_end;
+        const size_t len    = (size_t)(key_end - key);
+
+        size_t slot = JsonAPI_hash_range(key, key_end) & mask;
+        for(;;) {
+            JsonNode_t* cur = slots[slot];
+            if(cur == NULL) {
+                if(++used == num_slots) // there must always be an empty slot to end lookups
+                    return 0;
+                slots[slot] = pair;
+                break;
+            }
+
+            if((size_t)(cur->pair.key_end - cur->pair.key_start) == len && 
+                    memcmp(doc_source + cur->pair.key_start, key, len) == 0)
+                break; // duplicate, the first one stays
+
+            slot = (slot + 1ul) & mask;
+        }
+    }
+
+    index->doc_source = doc_source;
+    index->slots      = slots;
+    index->mask       = mask;
+    return 1;
+}
+
+JsonNode_t* JsonObjIndex_find(const JsonObjIndex_t* index, const char* fieldname) {
+    const char* const doc_source = index->doc_source;
+    size_t slot = JsonAPI_hash_cstr(fieldname) & index->mask;
+
+    JsonNode_t* cur;
+    while((cur = index->slots[slot]) != NULL) {
+        if(JsonAPI_string_eq(doc_source + cur->pair.key_start, doc_source + cur->pair.key_end, fieldname))
+            return cur;
+        slot = (slot + 1ul) & index->mask;
+    }
+
+    return NULL;
+}
+
+JsonNode_t* JsonObjIndex_find_key(const JsonObjIndex_t* index, const char* key, size_t len) {
+    const char* const doc_source = index->doc_source;
+    size_t slot = JsonAPI_hash_range(key, key + len) & index->mask;
+
+    JsonNode_t* cur;
+    while((cur = index->slots[slot]) != NULL) {
+        if((size_t)(cur->pair.key_end - cur->pair.key_start) == len && 
+                memcmp(doc_source + cur->pair.key_start, key, len) == 0)
+            return cur;
+        slot = (slot + 1ul) & index->mask;
+    }
+
+    return NULL;
+}
+
 int JsonObjIter_init(JsonObjIter_t* iter, JsonNode_t* top) {
     if(iter == NULL || top == NULL || top->type != JsonNodeType_object)
         return 0;
@@ -272,7 +425,7 @@ int JsonObjIter_next(JsonObjIter_t* iter) {
     return iter->current ? 1 : 0;
 }
 
-JsonNode_t* JsonObjIter_current(JsonObjIter_t* iter) {
+JsonNode_t* JsonObjIter_current(const JsonObjIter_t* iter) {
     return iter->current;
 }
 
@@ -291,11 +444,11 @@ static int JsonAPI_string_eq(const char* start, const char* end, const char* nt_
     return (start == end && c == '\0');
 }
 
-int JsonNumber_convert_from_json_string(const char* doc_source, JsonNode_t* num_node, JsonNumber_t* num) {
+int JsonNumber_convert_from_json_string(const char* doc_source, const JsonNode_t* num_node, JsonNumber_t* num) {
     if(doc_source == NULL || num_node == NULL || num_node->type != JsonNodeType_number || num_node == NULL)
         return 0;
 
-    unsigned int numlen = num_node->num.end - num_node->num.start;
+    JsonOffset_t numlen = num_node->num.end - num_node->num.start;
     if(numlen >= (JSONPARSER_MAX_NUM_LEN - 1))
         return 0;
 
@@ -349,6 +502,484 @@ int JsonNumber_convert_from_json_string(const char* doc_source, JsonNode_t* num_
     return 1;
 }
 
+//
+// exactly representable powers of ten
+//
+static const double JsonAPI_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+int JsonNumber_to_double(const char* doc_source, const JsonNode_t* num_node, double* value) {
+    if(doc_source == NULL || num_node == NULL || num_node->type != JsonNodeType_number)
+        return 0;
+
+    const char*       iter     = doc_source + num_node->num.start;
+    const char* const end_iter = doc_source + num_node->num.end;
+
+    if(iter >= end_iter)
+        return 0;
+
+    const int negative = (*iter == '-');
+    if(negative) iter++;
+
+    uint64_t mantissa = 0u;
+    int digits   = 0; // significant digits in mantissa
+    int exponent = 0;
+    int exact    = 1;
+
+    while(iter != end_iter && *iter >= '0' && *iter <= '9') {
+        if(digits < 19) {
+            mantissa = mantissa * 10u + (uint64_t)(*iter - '0');
+            if(mantissa != 0u) digits++;
+        } else {
+            exact = 0;
+        }
+        iter++;
+    }
+
+    if(iter != end_iter && *iter == '.') {
+        iter++;
+        while(iter != end_iter && *iter >= '0' && *iter <= '9') {
+            if(digits < 19) {
+                mantissa = mantissa * 10u + (uint64_t)(*iter - '0');
+                if(mantissa != 0u) digits++;
+                exponent--;
+            } else {
+                exact = 0;
+            }
+            iter++;
+        }
+    }
+
+    if(iter != end_iter && (*iter == 'e' || *iter == 'E')) {
+        iter++;
+        int exp_negative = 0;
+        if(iter != end_iter && (*iter == '-' || *iter == '+')) {
+            exp_negative = (*iter == '-');
+            iter++;
+        }
+
+        int e = 0;
+        while(iter != end_iter && *iter >= '0' && *iter <= '9') {
+            if(e < 100000) e = e * 10 + (*iter - '0');
+            iter++;
+        }
+        exponent += exp_negative ? -e : e;
+    }
+
+    if(iter != end_iter)
+        return 0;
+
+    // a mantissa below 2^53 and a power of ten up to 1e22 are both exact, 
+    // so one multiplication or division rounds correctly
+    if(exact && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double d = (double)mantissa;
+        if(exponent < 0) d /= JsonAPI_pow10[-exponent];
+        else             d *= JsonAPI_pow10[exponent];
+        *value = negative ? -d : d;
+        return 1;
+    }
+
+    if(exact && mantissa == 0u) {
+        *value = negative ? -0.0 : 0.0;
+        return 1;
+    }
+
+    const JsonOffset_t numlen = num_node->num.end - num_node->num.start;
+    if(numlen >= JSONPARSER_MAX_NUM_LEN)
+        return 0;
+
+    char tmpbuf[JSONPARSER_MAX_NUM_LEN];
+    memcpy(tmpbuf, doc_source + num_node->num.start, numlen);
+    tmpbuf[numlen] = '\0';
+    *value = strtod(tmpbuf, NULL);
+    return 1;
+}
+
+int JsonNumber_to_int64(const char* doc_source, const JsonNode_t* num_node, int64_t* value) {
+    if(doc_source == NULL || num_node == NULL || num_node->type != JsonNodeType_number)
+        return 0;
+
+    const char*       iter     = doc_source + num_node->num.start;
+    const char* const end_iter = doc_source + num_node->num.end;
+
+    if(iter >= end_iter)
+        return 0;
+
+    const int negative = (*iter == '-');
+    if(negative) iter++;
+
+    // accumulate the magnitude, which for INT64_MIN is one more than INT64_MAX
+    const uint64_t limit = negative ? (uint64_t)INT64_MAX + 1u : (uint64_t)INT64_MAX;
+    uint64_t magnitude = 0u;
+
+    while(iter != end_iter && *iter >= '0' && *iter <= '9') {
+        const uint64_t digit = (uint64_t)(*iter - '0');
+        if(magnitude > (limit - digit) / 10u)
+            return 0;
+        magnitude = magnitude * 10u + digit;
+        iter++;
+    }
+
+    if(iter != end_iter) {
+        if(*iter != '.' && *iter != 'e' && *iter != 'E')
+            return 0;
+
+        double d;
+        if(!JsonNumber_to_double(doc_source, num_node, &d))
+            return 0;
+
+        // 2^63 is exact as a double, so the range check is too
+        if(!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || d != (double)(int64_t)d)
+            return 0;
+        *value = (int64_t)d;
+        return 1;
+    }
+
+    if(negative && magnitude != 0u)
+        *value = -(int64_t)(magnitude - 1u) - 1; // INT64_MIN without overflow
+    else
+        *value = (int64_t)magnitude;
+    return 1;
+}
+
+//
+// reads the unescaped content of a string or key in chunks. text without 
+// escape sequences comes back as one chunk straight out of the source
+//
+typedef struct {
+    const char* iter;
+    const char* end;
+    int escaped;
+    char decoded[8]; // one escape sequence decodes to at most 4 bytes
+} JsonAPI_string_reader_t;
+
+static void JsonAPI_string_reader_init(JsonAPI_string_reader_t* r, const char* start, const char* end, unsigned int flags) {
+    r->iter    = start;
+    r->end     = end;
+    r->escaped = (flags & JsonNodeFlag_escaped) != 0u;
+}
+
+//
+// returns the length of the next chunk and sets chunk, or 0 at the end
+//
+static size_t JsonAPI_string_chunk(JsonAPI_string_reader_t* r, const char** chunk) {
+    if(r->iter >= r->end)
+        return 0ul;
+
+    if(r->escaped && *r->iter == '\\') {
+        size_t len = 0ul;
+        r->iter = JsonParser_decode_escape(r->iter, r->end, r->decoded, &len);
+        *chunk = r->decoded;
+        if(len == 0ul) // malformed escapes decode to nothing
+            return JsonAPI_string_chunk(r, chunk);
+        return len;
+    }
+
+    const char* start = r->iter;
+    if(r->escaped) {
+        const char* bs = (const char*)memchr(start, '\\', (size_t)(r->end - start));
+        r->iter = (bs != NULL) ? bs : r->end;
+    } else {
+        r->iter = r->end;
+    }
+
+    *chunk = start;
+    return (size_t)(r->iter - start);
+}
+
+static int JsonAPI_text_equal(
+        const char* a_start, const char* a_end, unsigned int a_flags,
+        const char* b_start, const char* b_end, unsigned int b_flags) {
+
+    const size_t a_len = (size_t)(a_end - a_start);
+    const size_t b_len = (size_t)(b_end - b_start);
+
+    // identical raw text means identical content, whatever the escapes are
+    if(a_len == b_len && memcmp(a_start, b_start, a_len) == 0 && 
+            ((a_flags ^ b_flags) & JsonNodeFlag_escaped) == 0u)
+        return 1;
+
+    // without escapes the content is the raw text
+    if(((a_flags | b_flags) & JsonNodeFlag_escaped) == 0u)
+        return 0;
+
+    JsonAPI_string_reader_t ra, rb;
+    JsonAPI_string_reader_init(&ra, a_start, a_end, a_flags);
+    JsonAPI_string_reader_init(&rb, b_start, b_end, b_flags);
+
+    const char* ca = NULL;
+    const char* cb = NULL;
+    size_t la = 0ul;
+    size_t lb = 0ul;
+
+    for(;;) {
+        if(la == 0ul) la = JsonAPI_string_chunk(&ra, &ca);
+        if(lb == 0ul) lb = JsonAPI_string_chunk(&rb, &cb);
+        if(la == 0ul || lb == 0ul)
+            return la == lb;
+
+        const size_t n = (la < lb) ? la : lb;
+        if(memcmp(ca, cb, n) != 0)
+            return 0;
+        ca += n; la -= n;
+        cb += n; lb -= n;
+    }
+}
+
+static inline uint64_t JsonAPI_hash_u64(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 32);
+}
+
+//
+// hashes bytes 8 at a time. text can be fed in chunks of any size 
+// and hashes the same however it is split
+//
+typedef struct {
+    uint64_t h;
+    uint64_t word;
+    unsigned int fill; // bytes in word
+} JsonAPI_hasher_t;
+
+static void JsonAPI_hasher_feed(JsonAPI_hasher_t* hs, const char* bytes, size_t len) {
+    while(len > 0ul && hs->fill != 0u) {
+        hs->word |= (uint64_t)(unsigned char)*(bytes++) << (hs->fill * 8u);
+        len--;
+        if(++hs->fill == 8u) {
+            hs->h = JsonAPI_hash_u64(hs->h, hs->word);
+            hs->word = 0u;
+            hs->fill = 0u;
+        }
+    }
+
+    while(len >= 8ul) {
+        uint64_t w = 0u;
+        int i;
+        for(i = 7; i >= 0; i--) // little-endian regardless of the host
+            w = (w << 8) | (unsigned char)bytes[i];
+        hs->h = JsonAPI_hash_u64(hs->h, w);
+        bytes += 8;
+        len   -= 8ul;
+    }
+
+    while(len > 0ul) {
+        hs->word |= (uint64_t)(unsigned char)*(bytes++) << (hs->fill * 8u);
+        hs->fill++;
+        len--;
+    }
+}
+
+//
+// spreads a finished hash before it is combined without regard to order
+//
+static inline uint64_t JsonAPI_hash_finish(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t JsonAPI_hash_text(uint64_t h, const char* start, const char* end, unsigned int flags) {
+    JsonAPI_string_reader_t r;
+    JsonAPI_string_reader_init(&r, start, end, flags);
+
+    JsonAPI_hasher_t hs;
+    hs.h    = h;
+    hs.word = 0u;
+    hs.fill = 0u;
+
+    uint64_t total = 0u;
+    const char* chunk;
+    size_t len;
+    while((len = JsonAPI_string_chunk(&r, &chunk)) != 0ul) {
+        JsonAPI_hasher_feed(&hs, chunk, len);
+        total += len;
+    }
+
+    // the length keeps "ab","c" apart from "a","bc"
+    return JsonAPI_hash_u64(JsonAPI_hash_u64(hs.h, hs.word), total);
+}
+
+//
+// numbers that are equal by JsonNode_equal hash the same
+//
+static uint64_t JsonAPI_hash_number(uint64_t h, const char* doc_source, const JsonNode_t* num) {
+    int64_t i;
+    double d;
+
+    if(JsonNumber_to_int64(doc_source, num, &i))
+        return JsonAPI_hash_u64(h ^ 1u, (uint64_t)i);
+
+    if(JsonNumber_to_double(doc_source, num, &d)) {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return JsonAPI_hash_u64(h ^ 2u, bits);
+    }
+
+    return JsonAPI_hash_text(h ^ 3u, doc_source + num->num.start, doc_source + num->num.end, 0u);
+}
+
+static int JsonAPI_number_equal(const char* a_source, const JsonNode_t* a, const char* b_source, const JsonNode_t* b) {
+    const size_t a_len = (size_t)(a->num.end - a->num.start);
+    const size_t b_len = (size_t)(b->num.end - b->num.start);
+    if(a_len == b_len && memcmp(a_source + a->num.start, b_source + b->num.start, a_len) == 0)
+        return 1;
+
+    int64_t ia, ib;
+    const int a_int = JsonNumber_to_int64(a_source, a, &ia);
+    const int b_int = JsonNumber_to_int64(b_source, b, &ib);
+    if(a_int || b_int)
+        return a_int && b_int && ia == ib;
+
+    double da, db;
+    if(JsonNumber_to_double(a_source, a, &da) && JsonNumber_to_double(b_source, b, &db))
+        return da == db;
+    return 0; // too long to convert and not identical
+}
+
+uint64_t JsonNode_hash(const char* doc_source, const JsonNode_t* node, int ignore_key_order) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    if(doc_source == NULL || node == NULL)
+        return h;
+
+    const JsonNode_t* iter;
+    h = JsonAPI_hash_u64(h, (uint64_t)node->type);
+
+    switch(node->type) {
+    case JsonNodeType_object:
+    {
+        uint64_t sum = 0u;
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next) {
+            const uint64_t field = JsonNode_hash(doc_source, iter, ignore_key_order);
+            if(ignore_key_order) sum += JsonAPI_hash_finish(field);
+            else                 h = JsonAPI_hash_u64(h, field);
+        }
+        if(ignore_key_order)
+            h = JsonAPI_hash_u64(h, sum);
+        break;
+    }
+    case JsonNodeType_pair:
+        h = JsonAPI_hash_text(h, doc_source + node->pair.key_start, doc_source + node->pair.key_end, node->flags);
+        h = JsonAPI_hash_u64(h, JsonNode_hash(doc_source, node->pair.value, ignore_key_order));
+        break;
+    case JsonNodeType_array:
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next)
+            h = JsonAPI_hash_u64(h, JsonNode_hash(doc_source, iter->elem.item, ignore_key_order));
+        break;
+    case JsonNodeType_element:
+        return JsonNode_hash(doc_source, node->elem.item, ignore_key_order);
+    case JsonNodeType_string:
+        h = JsonAPI_hash_text(h, doc_source + node->str.start, doc_source + node->str.end, node->flags);
+        break;
+    case JsonNodeType_number:
+        h = JsonAPI_hash_number(h, doc_source, node);
+        break;
+    default:
+        break;
+    }
+
+    return h;
+}
+
+static int JsonAPI_key_equal(const char* a_source, const JsonNode_t* a, const char* b_source, const JsonNode_t* b) {
+    return JsonAPI_text_equal(
+            a_source + a->pair.key_start, a_source + a->pair.key_end, a->flags,
+            b_source + b->pair.key_start, b_source + b->pair.key_end, b->flags);
+}
+
+static int JsonAPI_field_equal(const char* a_source, const JsonNode_t* a, const char* b_source, const JsonNode_t* b, int ignore_key_order) {
+    return 
+            JsonAPI_key_equal(a_source, a, b_source, b) && 
+            JsonNode_equal(a_source, a->pair.value, b_source, b->pair.value, ignore_key_order);
+}
+
+int JsonNode_equal(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        int ignore_key_order) {
+
+    if(a == NULL || b == NULL)
+        return a == b;
+    if(a_source == b_source && a == b)
+        return 1;
+
+    if(a->type == JsonNodeType_element) a = a->elem.item;
+    if(b->type == JsonNodeType_element) b = b->elem.item;
+    if(a == NULL || b == NULL)
+        return a == b;
+
+    if(a->type != b->type)
+        return 0;
+
+    const JsonNode_t* ia;
+    const JsonNode_t* ib;
+
+    switch(a->type) {
+    case JsonNodeType_object:
+        // fields in the same order is the common case, and the only one without ignore_key_order
+        for(ia = a->obj.first, ib = b->obj.first; ia != NULL && ib != NULL; ia = ia->pair.next, ib = ib->pair.next) {
+            if(!JsonAPI_field_equal(a_source, ia, b_source, ib, ignore_key_order))
+                break;
+        }
+
+        if(ia == NULL || ib == NULL)
+            return ia == ib;
+        if(!ignore_key_order)
+            return 0;
+
+        {
+            // field counts from where the orders diverge
+            size_t na = 0ul;
+            size_t nb = 0ul;
+            const JsonNode_t* iter;
+            for(iter = ia; iter != NULL; iter = iter->pair.next) na++;
+            for(iter = ib; iter != NULL; iter = iter->pair.next) nb++;
+            if(na != nb)
+                return 0;
+
+            //
+            // the n-th field of a that equals ia is paired with the n-th 
+            // such field of b. with equal counts that pairs every field 
+            // once, like the sum of field hashes counts them
+            //
+            const JsonNode_t* rest_a = ia;
+            const JsonNode_t* rest_b = ib;
+            for(; ia != NULL; ia = ia->pair.next) {
+                size_t n = 0ul;
+                for(iter = rest_a; iter != ia; iter = iter->pair.next)
+                    if(JsonAPI_field_equal(a_source, iter, a_source, ia, ignore_key_order))
+                        n++;
+
+                for(ib = rest_b; ib != NULL; ib = ib->pair.next)
+                    if(JsonAPI_field_equal(a_source, ia, b_source, ib, ignore_key_order) && n-- == 0ul)
+                        break;
+                if(ib == NULL)
+                    return 0;
+            }
+        }
+        return 1;
+    case JsonNodeType_pair:
+        return JsonAPI_field_equal(a_source, a, b_source, b, ignore_key_order);
+    case JsonNodeType_array:
+        for(ia = a->arr.first, ib = b->arr.first; ia != NULL && ib != NULL; ia = ia->elem.next, ib = ib->elem.next)
+            if(!JsonNode_equal(a_source, ia->elem.item, b_source, ib->elem.item, ignore_key_order))
+                return 0;
+        return ia == ib;
+    case JsonNodeType_string:
+        return JsonAPI_text_equal(
+                a_source + a->str.start, a_source + a->str.end, a->flags,
+                b_source + b->str.start, b_source + b->str.end, b->flags);
+    case JsonNodeType_number:
+        return JsonAPI_number_equal(a_source, a, b_source, b);
+    default:
+        return 1;
+    }
+}
+
 void JsonDateTime_init_default(JsonDateTime_t* dt) {
     dt->year = 0;
     dt->month = 0;
@@ -396,7 +1027,7 @@ static inline char* JsonAPI_place_int(int val, char* d, int dlen) {
     return tmp;
 }
 
-int JsonDateTime_to_string(JsonDateTime_t* dt, char* dest, int dlen) {
+int JsonDateTime_to_string(const JsonDateTime_t* dt, char* dest, int dlen) {
     if(dlen != JSONDATETIME_LEN && dlen != JSONDATETIME_LEN_TR)
         return 0;
 
@@ -455,7 +1086,7 @@ static int JsonAPI_date_time_from_string(JsonDateTime_t* dt, const char* start,
     return 0;
 }
 
-int JsonDateTime_from_json_string(JsonDateTime_t* dt, JsonString_t* str) {
+int JsonDateTime_from_json_string(JsonDateTime_t* dt, const JsonString_t* str) {
     return JsonAPI_date_time_from_string(dt, str->doc_source + str->start, str->doc_source + str->end);
 }
 
@@ -19,18 +19,31 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 // - iterating over objects/arrays
 // - performing type checks/conversions
 // - generating formatted JSON strings
-// - TODO : converting JSON to other file types
+//
+// none of these functions modify the document. iterator and index state 
+// lives in caller-owned structures, so a parsed document can be read by 
+// any number of threads at once as long as no thread parses into, resets 
+// or deletes it at the same time. JsonObjIndex_t is built once up front 
+// and is read-only afterwards, so it can be shared the same way
 //
 
 #include "json-parser.h"
 #include "json-parser-config.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
+//
+// a string in the source of a document. fill it in with JsonString_init or 
+// JsonPair_key. strings filled in by hand must set flags too: backslashes 
+// are only read as escape sequences when JsonNodeFlag_escaped is set, 
+// because in-situ parsed and binary decoded strings hold plain text
+//
 typedef struct JsonString {
     const char* doc_source;
-    unsigned int start;
-    unsigned int end;
+    JsonOffset_t start;
+    JsonOffset_t end;
+    unsigned int flags; // JsonNodeFlag_t bits copied from the originating node
 } JsonString_t;
 
 //
@@ -50,10 +63,46 @@ JsonNode_t* JsonObj_first_field(JsonNode_t* obj);
 // simple access wrapper
 //
 JsonNode_t* JsonPair_field(JsonNode_t* pair);
-int JsonPair_key(JsonNode_t* pair, const char* doc_source, JsonString_t* str);
+int JsonPair_key(const JsonNode_t* pair, const char* doc_source, JsonString_t* str);
 
 JsonNode_t* JsonArr_index(JsonNode_t* arr, size_t idx);
 
+//
+// hash index over the fields of one object for repeated lookups by name.
+// the slots are supplied by the caller and the index never changes after 
+// JsonObjIndex_init, so lookups do not write to anything
+//
+typedef struct JsonObjIndex {
+    const char* doc_source;
+    JsonNode_t** slots;
+    size_t mask; // number of slots - 1
+} JsonObjIndex_t;
+
+//
+// number of slots JsonObjIndex_init needs for the given object. 
+// returns 0 if obj is not an object
+//
+size_t JsonObjIndex_slots_needed(const JsonNode_t* obj);
+
+//
+// build an index over the fields of obj using num_slots entries of slots.
+// num_slots must be a power of two greater than the number of fields.
+// with duplicate field names, the first one is indexed like JsonObj_field_by_name.
+// returns 1 on success, else 0
+//
+int JsonObjIndex_init(JsonObjIndex_t* index, const char* doc_source, JsonNode_t* obj, JsonNode_t** slots, size_t num_slots);
+
+//
+// look up a field by name. returns pointer to JSON pair if found, else NULL
+//
+JsonNode_t* JsonObjIndex_find(const JsonObjIndex_t* index, const char* fieldname);
+
+//
+// same as JsonObjIndex_find for a name of len bytes that is not 
+// null-terminated, such as the raw key of a pair in another document
+//
+JsonNode_t* JsonObjIndex_find_key(const JsonObjIndex_t* index, const char* key, size_t len);
+
 typedef struct JsonArrIter {
     JsonNode_t* arr;
     JsonNode_t* element;
@@ -61,7 +110,7 @@ typedef struct JsonArrIter {
 
 int JsonArrIter_init(JsonArrIter_t* iter, JsonNode_t* arr);
 int JsonArrIter_next(JsonArrIter_t* iter);
-JsonNode_t* JsonArrIter_current(JsonArrIter_t* iter);
+JsonNode_t* JsonArrIter_current(const JsonArrIter_t* iter);
 
 typedef struct JsonObjIter {
     JsonNode_t* obj;
@@ -83,19 +132,19 @@ int JsonObjIter_next(JsonObjIter_t* iter);
 // returns the field currently referred to be the iterator
 // NULL if no field
 //
-JsonNode_t* JsonObjIter_current(JsonObjIter_t* iter);
+JsonNode_t* JsonObjIter_current(const JsonObjIter_t* iter);
 
 //
 // compare the currently referenced field name with the given fieldname
 // returns 1 if field name matched else 0
 //
-int JsonObjIter_field_name_matches(JsonObjIter_t* iter, const char* doc_source, const char* fieldname);
+int JsonObjIter_field_name_matches(const JsonObjIter_t* iter, const char* doc_source, const char* fieldname);
 
 //
 // initialize JsonString_t to reference the same data as the orginal JsonNode_t::string type
 // returns 1 on success, else 0
 //
-int JsonString_init(JsonString_t* str, const char* doc_source, JsonNode_t* str_node);
+int JsonString_init(JsonString_t* str, const char* doc_source, const JsonNode_t* str_node);
 
 //
 // return length (in bytes) of given JsonString_t
@@ -103,14 +152,39 @@ int JsonString_init(JsonString_t* str, const char* doc_source, JsonNode_t* str_n
 // or redefined utf-8 sequences. it represents an upper limit on the 
 // size of the given string
 //
-unsigned long JsonString_size(JsonString_t* str);
+unsigned long JsonString_size(const JsonString_t* str);
 
 //
 // copy the contents of the string out of the original source
+// escape sequences are only decoded if str->flags has JsonNodeFlag_escaped, 
+// otherwise backslashes are copied like any other character
 // returns the actual (byte) size of the copied out string
 //
 size_t JsonString_copy(const JsonString_t* str, char* restrict dest);
 
+//
+// copy the contents of the string out of the original source, preserving UTF-8.
+// escape sequences are decoded exactly, including \uXXXX escapes and surrogate 
+// pairs which are written out as UTF-8. unpaired surrogates become U+FFFD and
+// malformed escape sequences are dropped. like JsonString_copy this 
+// needs JsonNodeFlag_escaped in str->flags to decode anything.
+// the JSONPARSER_*_ALT substitutions and non-printable filtering are not applied.
+// dest must be able to hold at least JsonString_size(str) bytes.
+// returns the actual (byte) size of the copied out string
+//
+size_t JsonString_copy_utf8(const JsonString_t* str, char* restrict dest);
+
+//
+// get a view of the contents of the string without copying when possible.
+// if the string has no escape sequences and no non-ASCII bytes, a pointer 
+// directly into the original source is returned. otherwise the string is 
+// copied into scratch with JsonString_copy and scratch is returned. scratch 
+// must be able to hold at least JsonString_size(str) bytes.
+// the length of the view is written to len. views are not null-terminated.
+// NOTE : direct views are not filtered by JSONPARSER_FILTER_NONPRINTABLE_ASCII
+//
+const char* JsonString_view(const JsonString_t* str, char* restrict scratch, size_t* len);
+
 //
 // structure for holding one of the primitive types that 
 // the number conversion routines recognize
@@ -134,7 +208,41 @@ typedef struct JsonNumber {
 // converts contents of given JsonNodeType_number node to actual primitive number type
 // returns 1 on success, else 0
 //
-int JsonNumber_convert_from_json_string(const char* doc_source, JsonNode_t* num_node, JsonNumber_t* num);
+int JsonNumber_convert_from_json_string(const char* doc_source, const JsonNode_t* num_node, JsonNumber_t* num);
+
+//
+// convert a number node straight from the source, without the copy that 
+// JsonNumber_convert_from_json_string makes. decimals with at most 19 
+// significant digits and a small exponent are converted directly and 
+// correctly rounded, anything else falls back to strtod.
+// JsonNumber_to_int64 also accepts a real that holds an integral value 
+// (such as 1.5e3) and fails if the value does not fit.
+// returns 1 on success, else 0 and value is left untouched
+//
+int JsonNumber_to_int64(const char* doc_source, const JsonNode_t* num_node, int64_t* value);
+int JsonNumber_to_double(const char* doc_source, const JsonNode_t* num_node, double* value);
+
+//
+// structural hash of the tree under node. strings and keys are hashed 
+// by their unescaped content and numbers by value, so "\u0041" hashes 
+// like "A" and 1.0 like 1. with ignore_key_order, the fields of objects 
+// can be in any order. trees that are JsonNode_equal hash the same
+//
+uint64_t JsonNode_hash(const char* doc_source, const JsonNode_t* node, int ignore_key_order);
+
+//
+// deep equality of two trees, which may come from different sources. 
+// strings are compared by unescaped content, numbers by value (integers 
+// exactly, anything else as doubles). identical raw text is compared 
+// with memcmp before anything is decoded. with ignore_key_order, objects 
+// are equal if their fields can be paired up one to one by equal name 
+// and value, so duplicate names have to occur as often in both.
+// returns 1 if equal, else 0
+//
+int JsonNode_equal(
+        const char* a_source, const JsonNode_t* a,
+        const char* b_source, const JsonNode_t* b,
+        int ignore_key_order);
 
 //
 // structure holding a date/time as per ISO-8601
@@ -163,12 +271,12 @@ void JsonDateTime_init_default(JsonDateTime_t* dt);
 // will output truncated ISO-8601 (no milliseconds field) if dlen==20 and full time string if dlen==24
 // other dlen's return 0 right away
 //
-int JsonDateTime_to_string(JsonDateTime_t* dt, char* dest, int dlen);
+int JsonDateTime_to_string(const JsonDateTime_t* dt, char* dest, int dlen);
 
 //
 // convert given JsonString_t in ISO-8601 to JsonDateTime_t structure
 //
-int JsonDateTime_from_json_string(JsonDateTime_t* dt, JsonString_t* str);
+int JsonDateTime_from_json_string(JsonDateTime_t* dt, const JsonString_t* str);
 
 //
 // convert given c-string in ISO-8601 to JsonDateTime_t structure
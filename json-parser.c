@@ -15,6 +15,10 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 #include "json-parser.h"
 #include "json-parser-config.h"
 
+#ifdef JSONPARSER_COLLECT_STATS
+#include <time.h>
+#endif
+
 #ifdef JSONPARSER_HAS_MALLOC
 
 #include <stdio.h>
@@ -23,6 +27,7 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 JsonNode_t* JsonParser_default_allocate_node(void* const _unused) {
     JsonNode_t* node = (JsonNode_t*)malloc(sizeof(JsonNode_t));
     node->type = JsonNodeType_none;
+    node->flags = 0u;
     node->pair.key_start = 0;
     node->pair.key_end   = 0;
     node->pair.next      = NULL;
@@ -42,87 +47,220 @@ void JsonParser_default_delete_node(void* const alloc_data, JsonNode_t* node) {
 
 #endif // JSONPARSER_HAS_MALLOC
 
+#ifdef JSONPARSER_COLLECT_STATS
+
+static void JsonParser_stat_string(JsonParseStats_t* stats, const char* start, const char* end, unsigned int flags) {
+    stats->string_bytes += (unsigned long)(end - start);
+
+    if(flags & JsonNodeFlag_escaped) {
+        while(start < end) {
+            if(*start == '\\') {
+                stats->escapes++;
+                start++; // skip escaped char
+            }
+            start++;
+        }
+    }
+}
+
+//
+// wall-clock time in nanoseconds
+//
+static unsigned long long JsonParser_time_ns(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+void JsonParseStats_init(JsonParseStats_t* stats) {
+    int i;
+    for(i = 0; i <= JsonNodeType_null; i++)
+        stats->nodes[i] = 0ul;
+
+    stats->documents      = 0ul;
+    stats->bytes_consumed = 0ul;
+    stats->max_depth      = 0ul;
+    stats->string_bytes   = 0ul;
+    stats->number_bytes   = 0ul;
+    stats->escapes        = 0ul;
+    stats->parse_ns       = 0ull;
+    stats->delete_ns      = 0ull;
+}
+
+void JsonParser_attach_stats(JsonDocument_t* doc, JsonParseStats_t* stats) {
+    doc->stats = stats;
+}
+
+#endif // JSONPARSER_COLLECT_STATS
+
 void JsonParser_init_document(
         JsonDocument_t* doc,
         JsonParser_dealloc_callback delete_node_cb,
         JsonParser_alloc_callback allocate_node_cb,
         void* alloc_data) {
 
-    doc->allocate_node_cb = allocate_node_cb;
-    doc->dealloc_node_cb  = delete_node_cb;
+    doc->allocate_node_cb  = allocate_node_cb;
+    doc->allocate_block_cb = NULL;
+    doc->dealloc_node_cb   = delete_node_cb;
     doc->first = NULL;
+    doc->free_nodes = NULL;
+    doc->block_next = NULL;
+    doc->block_end  = NULL;
     doc->alloc_data = alloc_data;
+    doc->error_offset = 0ul;
+#ifdef JSONPARSER_COLLECT_STATS
+    doc->stats = NULL;
+#endif
 }
 
-void JsonParser_delete_document(JsonDocument_t* doc) {
-
-    if(doc->first == NULL) return;
-
-    JsonParser_dealloc_callback delete_node = doc->dealloc_node_cb;
-    void* const alloc_data = doc->alloc_data;
-
-    JsonNode_t* node_stack[JSONPARSER_MAX_DEPTH] = {NULL};
-
-    if(doc->first->type == JsonNodeType_array || doc->first->type == JsonNodeType_object)
-        node_stack[0] = doc->first;
-    else
-        return;
-
-    long int stack_pointer = 0;
-
-    while(stack_pointer >= 0) {
-
-        JsonNode_t* top = node_stack[stack_pointer];
-
-        if(top == NULL) {
-            stack_pointer--;
-            continue;
-        }
+void JsonParser_init_document_block(
+        JsonDocument_t* doc,
+        JsonParser_dealloc_callback delete_node_cb,
+        JsonParser_alloc_block_callback allocate_block_cb,
+        void* alloc_data) {
 
-        switch(top->type) {
-        case JsonNodeType_none:
-            return;
+    JsonParser_init_document(doc, delete_node_cb, NULL, alloc_data);
+    doc->allocate_block_cb = allocate_block_cb;
+}
 
+//
+// hand every node of the tree below node to release_node. no stack is 
+// needed. children are unlinked from their container as they are visited 
+// and nested containers return to the node that contains them through 
+// their parent link once they are empty
+//
+static void JsonParser_release_tree(JsonNode_t* node, JsonParser_dealloc_callback release_node, void* const alloc_data) {
+    while(node != NULL) {
+        switch(node->type) {
         case JsonNodeType_object: {
-            JsonNode_t* tmp = top->obj.first;
-            delete_node(alloc_data, top);
-            node_stack[stack_pointer] = tmp;
+            JsonNode_t* pair = node->obj.first;
+            if(pair == NULL) {
+                JsonNode_t* parent = node->parent;
+                release_node(alloc_data, node);
+                node = parent;
+            } else {
+                node = pair;
+            }
             break;
         }
         case JsonNodeType_pair: {
-            JsonNode_t* value = top->pair.value;
-            JsonNode_t* next  = top->pair.next;
-            delete_node(alloc_data, top);
-            node_stack[stack_pointer]   = next;
-            node_stack[++stack_pointer] = value; // value needs to be deleted first
+            JsonNode_t* value = node->pair.value;
+            if(value != NULL && (value->type == JsonNodeType_object || value->type == JsonNodeType_array)) {
+                node->pair.value = NULL; // value comes back to this pair once it is empty
+                node = value;
+            } else {
+                JsonNode_t* obj = node->parent;
+                obj->obj.first = node->pair.next;
+                if(value != NULL) release_node(alloc_data, value);
+                release_node(alloc_data, node);
+                node = obj;
+            }
             break;
         }
         case JsonNodeType_array: {
-            JsonNode_t* tmp = top->arr.first;
-            delete_node(alloc_data, top);
-            node_stack[stack_pointer] = tmp;
-            break;
-        }
-        case JsonNodeType_element: {
-            JsonNode_t* item = top->elem.item;
-            JsonNode_t* next = top->elem.next;
-            delete_node(alloc_data, top);
-            node_stack[stack_pointer]   = next;
-            node_stack[++stack_pointer] = item;
+            JsonNode_t* elem = node->arr.first;
+            if(elem == NULL) {
+                JsonNode_t* parent = node->parent;
+                release_node(alloc_data, node);
+                node = parent;
+                break;
+            }
+
+            JsonNode_t* item = elem->elem.item;
+            if(item != NULL && (item->type == JsonNodeType_object || item->type == JsonNodeType_array)) {
+                elem->elem.item = NULL; // item comes back to this array once it is empty
+                node = item;
+            } else {
+                node->arr.first = elem->elem.next;
+                if(item != NULL) release_node(alloc_data, item);
+                release_node(alloc_data, elem);
+            }
             break;
         }
-        case JsonNodeType_string:
-        case JsonNodeType_number:
-        case JsonNodeType_true:
-        case JsonNodeType_false:
-        case JsonNodeType_null:
-            delete_node(alloc_data, top);
-            stack_pointer--;
+        default: // top-level node is not a container
+            release_node(alloc_data, node);
+            node = NULL;
             break;
         }
     }
 }
 
+//
+// keeps a node on the document for the next parse. parent is the free list link
+//
+static void JsonParser_recycle_node(void* const doc_ptr, JsonNode_t* node) {
+    JsonDocument_t* doc = (JsonDocument_t*)doc_ptr;
+    node->parent = doc->free_nodes;
+    doc->free_nodes = node;
+}
+
+void JsonParser_delete_document(JsonDocument_t* doc) {
+
+    JsonParser_dealloc_callback delete_node = doc->dealloc_node_cb;
+    // the rest of the current block was never handed out and stays with the allocator
+    doc->block_next = NULL;
+    doc->block_end  = NULL;
+
+    if(delete_node == NULL) { // nodes belong to an arena that is released all at once
+        doc->first = NULL;
+        doc->free_nodes = NULL;
+        return;
+    }
+
+    void* const alloc_data = doc->alloc_data;
+
+    JsonNode_t* node = doc->free_nodes;
+    doc->free_nodes = NULL;
+    while(node != NULL) {
+        JsonNode_t* next = node->parent;
+        delete_node(alloc_data, node);
+        node = next;
+    }
+
+    if(doc->first == NULL) return;
+
+    node = doc->first;
+    doc->first = NULL;
+
+#ifdef JSONPARSER_COLLECT_STATS
+    const unsigned long long delete_start = doc->stats ? JsonParser_time_ns() : 0ull;
+#endif
+
+    JsonParser_release_tree(node, delete_node, alloc_data);
+
+#ifdef JSONPARSER_COLLECT_STATS
+    if(doc->stats != NULL)
+        doc->stats->delete_ns += JsonParser_time_ns() - delete_start;
+#endif
+}
+
+void JsonParser_reset_document(JsonDocument_t* doc) {
+    JsonNode_t* node = doc->first;
+    doc->first = NULL;
+    doc->error_offset = 0ul;
+
+    if(node != NULL)
+        JsonParser_release_tree(node, JsonParser_recycle_node, doc);
+}
+
+void JsonParser_release_document_nodes(JsonDocument_t* doc, JsonNode_t* node) {
+    if(node == NULL) return;
+
+    JsonNode_t* value = node;
+    if(node->type == JsonNodeType_pair) {
+        value = node->pair.value;
+        JsonParser_recycle_node(doc, node);
+    } else if(node->type == JsonNodeType_element) {
+        value = node->elem.item;
+        JsonParser_recycle_node(doc, node);
+    }
+
+    if(value != NULL) {
+        value->parent = NULL; // the walk ends at the subtree root
+        JsonParser_release_tree(value, JsonParser_recycle_node, doc);
+    }
+}
+
 const char* JsonParseCode_as_string(JsonParseCode_t c) {
     switch(c) {
     case JsonParseCode_success:                return "success";
@@ -137,6 +275,8 @@ const char* JsonParseCode_as_string(JsonParseCode_t c) {
     case JsonParseCode_allocation_failure:     return "allocation failure";
     case JsonParseCode_unknown_internal_error: return "unknown internal error";
     case JsonParseCode_empty_source:           return "empty source";
+    case JsonParseCode_invalid_utf8:           return "invalid utf-8";
+    case JsonParseCode_offset_overflow:        return "offset overflow";
     default: return "UNKNOWN";
     }
 }
@@ -192,17 +332,107 @@ static inline const char* JsonParser_seek(const char* str) {
     return NULL;
 }
 
-static inline const char* JsonParser_consume_string(const char* str) {
+//
+// valid UTF-8 sequences indexed by lead byte (0xC0 - 0xFF), see 
+// table 3-7 of the Unicode standard. lo/hi is the valid range of 
+// the second byte. all other continuation bytes are 0x80 - 0xBF
+//
+static const struct {
+    unsigned char len;
+    unsigned char lo;
+    unsigned char hi;
+} JsonParser_utf8_lead[64] = {
+    {0, 0x00, 0x00}, {0, 0x00, 0x00}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xC0
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xC4
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xC8
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xCC
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xD0
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xD4
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xD8
+    {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, {2, 0x80, 0xBF}, // 0xDC
+    {3, 0xA0, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, // 0xE0
+    {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, // 0xE4
+    {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, // 0xE8
+    {3, 0x80, 0xBF}, {3, 0x80, 0x9F}, {3, 0x80, 0xBF}, {3, 0x80, 0xBF}, // 0xEC
+    {4, 0x90, 0xBF}, {4, 0x80, 0xBF}, {4, 0x80, 0xBF}, {4, 0x80, 0xBF}, // 0xF0
+    {4, 0x80, 0x8F}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, // 0xF4
+    {0, 0x00, 0x00}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, // 0xF8
+    {0, 0x00, 0x00}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, {0, 0x00, 0x00}, // 0xFC
+};
+
+//
+// returns the length of the valid UTF-8 sequence starting at str, 
+// 0 if the sequence is not valid
+//
+static inline int JsonParser_utf8_sequence_length(const char* str) {
+    const unsigned char* s = (const unsigned char*)str;
+    if(s[0] < 0xC0u)
+        return 0; // stray continuation byte
+
+    const int len = JsonParser_utf8_lead[s[0] - 0xC0u].len;
+    const unsigned char lo = JsonParser_utf8_lead[s[0] - 0xC0u].lo;
+    const unsigned char hi = JsonParser_utf8_lead[s[0] - 0xC0u].hi;
+
+    if(len == 0 || s[1] < lo || s[1] > hi)
+        return 0;
+    if(len > 2 && (s[2] & 0xC0u) != 0x80u)
+        return 0;
+    if(len > 3 && (s[3] & 0xC0u) != 0x80u)
+        return 0;
+    return len;
+}
+
+//
+// options used by JsonParser_parse_document, from json-parser-config.h
+//
+#ifdef JSONPARSER_NOT_STRICT
+#define JSONPARSER_DEFAULT_STRICT 0
+#else
+#define JSONPARSER_DEFAULT_STRICT 1
+#endif // JSONPARSER_NOT_STRICT
+
+#ifdef JSONPARSER_VALIDATE_UTF8
+#define JSONPARSER_DEFAULT_UTF8 1
+#else
+#define JSONPARSER_DEFAULT_UTF8 0
+#endif // JSONPARSER_VALIDATE_UTF8
+
+static const JsonParserOptions_t JsonParser_default_options = {
+    JSONPARSER_DEFAULT_STRICT,
+    JSONPARSER_DEFAULT_UTF8,
+    JSONPARSER_MAX_DEPTH,
+};
+
+//
+// consumes a string and records whether its contents need to be 
+// transformed before use (see JsonNodeFlag_t).
+// if the string contains invalid UTF-8, NULL is returned and error_at 
+// is set to the offending byte
+//
+static inline const char* JsonParser_consume_string(const char* str, unsigned int* flags, const char** error_at, const int validate_utf8) {
     // assume str currently points at '"'
     
+    unsigned int fl = 0u;
     str++;
     char c = *str;
     while(c) {
         if(c == '\\') {
-            str += 2; // no error check
+            fl |= JsonNodeFlag_escaped;
+            if(str[1] == '\0') return NULL; // never step over the terminator
+            str += 2;
         } else if(c == '"') {
+            *flags = fl;
             return str;
+        } else if(validate_utf8 && (unsigned char)c >= 0x80u) {
+            const int len = JsonParser_utf8_sequence_length(str);
+            if(len == 0) {
+                *error_at = str;
+                return NULL;
+            }
+            fl |= JsonNodeFlag_non_ascii;
+            str += len;
         } else {
+            fl |= ((unsigned char)c >> 6) & JsonNodeFlag_non_ascii; // set for any byte >= 0x80
             str++;
         }
         c = *str;
@@ -210,6 +440,139 @@ static inline const char* JsonParser_consume_string(const char* str) {
     return NULL;
 }
 
+//
+// parse 4 hex digits of a \uXXXX escape sequence.
+// returns 1 on success, else 0
+//
+static inline int JsonParser_parse_hex4(const char* src, const char* end, unsigned int* cp) {
+    if(end - src < 4)
+        return 0;
+
+    unsigned int v = 0u;
+    int i;
+    for(i = 0; i < 4; i++) {
+        const char c = src[i];
+        v <<= 4;
+        if(c >= '0' && c <= '9')      v |= (unsigned int)(c - '0');
+        else if(c >= 'a' && c <= 'f') v |= (unsigned int)(c - 'a' + 10);
+        else if(c >= 'A' && c <= 'F') v |= (unsigned int)(c - 'A' + 10);
+        else return 0;
+    }
+
+    *cp = v;
+    return 1;
+}
+
+//
+// write code point as UTF-8
+// returns how many bytes were written out
+//
+static inline size_t JsonParser_encode_utf8(unsigned int cp, char* dest) {
+    if(cp < 0x80u) {
+        dest[0] = (char)cp;
+        return 1;
+    } else if(cp < 0x800u) {
+        dest[0] = (char)(0xC0u | (cp >> 6));
+        dest[1] = (char)(0x80u | (cp & 0x3Fu));
+        return 2;
+    } else if(cp < 0x10000u) {
+        dest[0] = (char)(0xE0u | (cp >> 12));
+        dest[1] = (char)(0x80u | ((cp >> 6) & 0x3Fu));
+        dest[2] = (char)(0x80u | (cp & 0x3Fu));
+        return 3;
+    } else {
+        dest[0] = (char)(0xF0u | (cp >> 18));
+        dest[1] = (char)(0x80u | ((cp >> 12) & 0x3Fu));
+        dest[2] = (char)(0x80u | ((cp >> 6) & 0x3Fu));
+        dest[3] = (char)(0x80u | (cp & 0x3Fu));
+        return 4;
+    }
+}
+
+#define JSONPARSER_REPLACEMENT_CHAR 0xFFFDu
+
+const char* JsonParser_decode_escape(const char* src, const char* end, char* dest, size_t* dest_len) {
+    char c = (src + 1 < end) ? src[1] : '\0';
+
+    switch(c) {
+    case 'b':  dest[0] = '\b'; break;
+    case 'f':  dest[0] = '\f'; break;
+    case 'r':  dest[0] = '\r'; break;
+    case 't':  dest[0] = '\t'; break;
+    case 'n':  dest[0] = '\n'; break;
+    case '"':  dest[0] = '"';  break;
+    case '\\': dest[0] = '\\'; break;
+    case '/':  dest[0] = '/';  break;
+
+    case 'u': {
+        unsigned int cp;
+        if(!JsonParser_parse_hex4(src + 2, end, &cp))
+            return src + 2; // malformed, copy nothing
+        src += 6;
+
+        if(cp >= 0xD800u && cp <= 0xDBFFu) {
+            // high surrogate, must be followed by \uDC00-\uDFFF
+            unsigned int lo;
+            if(end - src >= 6 && src[0] == '\\' && src[1] == 'u' && 
+                    JsonParser_parse_hex4(src + 2, end, &lo) && lo >= 0xDC00u && lo <= 0xDFFFu) {
+                cp = 0x10000u + ((cp - 0xD800u) << 10) + (lo - 0xDC00u);
+                src += 6;
+            } else {
+                cp = JSONPARSER_REPLACEMENT_CHAR;
+            }
+        } else if(cp >= 0xDC00u && cp <= 0xDFFFu) {
+            cp = JSONPARSER_REPLACEMENT_CHAR; // unpaired low surrogate
+        }
+
+        *dest_len += JsonParser_encode_utf8(cp, dest);
+        return src;
+    }
+
+    default: return src + 2; // copy nothing i guess
+    }
+
+    *dest_len += 1;
+    return src + 2;
+}
+
+//
+// unescape string contents in place and null-terminate them.
+// returns the new end of the string
+//
+static inline char* JsonParser_unescape_insitu(char* start, char* end) {
+
+    // nothing needs to move until the first escape sequence
+    while(start < end && *start != '\\')
+        start++;
+
+    char* dest = start;
+    while(start < end) {
+        if(*start == '\\') {
+            size_t len = 0ul;
+            start = (char*)JsonParser_decode_escape(start, end, dest, &len);
+            dest += len;
+        } else {
+            *dest++ = *start++;
+        }
+    }
+
+    *dest = '\0';
+    return dest;
+}
+
+//
+// make string contents usable in place. returns the new end of the string
+//
+static inline const char* JsonParser_terminate_insitu(const char* start, const char* end, unsigned int* flags) {
+    if(*flags & JsonNodeFlag_escaped) {
+        *flags &= ~(unsigned int)JsonNodeFlag_escaped;
+        return JsonParser_unescape_insitu((char*)start, (char*)end);
+    }
+
+    *(char*)end = '\0';
+    return end;
+}
+
 static inline const int JsonParser_is_numeric(const char c) {
     return (c >= '0' && c <= '9');
 }
@@ -217,6 +580,7 @@ static inline const int JsonParser_is_numeric(const char c) {
 static inline JsonNode_t* JsonParser_init_element_node(JsonNode_t* node, JsonNode_t* parent) {
     if(node == NULL) return NULL;
     node->type = JsonNodeType_element;
+    node->flags = 0u;
     node->parent = parent;
     return node;
 }
@@ -224,6 +588,7 @@ static inline JsonNode_t* JsonParser_init_element_node(JsonNode_t* node, JsonNod
 static inline JsonNode_t* JsonParser_init_string_node(JsonNode_t* node, JsonNode_t* parent) {
     if(node == NULL) return NULL;
     node->type = JsonNodeType_string;
+    node->flags = 0u;
     node->parent = parent;
     return node;
 }
@@ -231,6 +596,7 @@ static inline JsonNode_t* JsonParser_init_string_node(JsonNode_t* node, JsonNode
 static inline JsonNode_t* JsonParser_init_number_node(JsonNode_t* node, JsonNode_t* parent) {
     if(node == NULL) return NULL;
     node->type = JsonNodeType_number;
+    node->flags = 0u;
     node->parent = parent;
     return node;
 }
@@ -238,6 +604,7 @@ static inline JsonNode_t* JsonParser_init_number_node(JsonNode_t* node, JsonNode
 static inline JsonNode_t* JsonParser_init_tfn_node(JsonNode_t* node, JsonNodeType_t type, JsonNode_t* parent) {
     if(node == NULL) return NULL;
     node->type = type;
+    node->flags = 0u;
     node->parent = parent;
     return node;
 }
@@ -274,7 +641,7 @@ static inline const char* JsonParser_consume_number_fraction(const char* str, Js
         c = *(++str);
 
     if(c == 'e' || c == 'E') {
-        return JsonParser_consume_number_exp(str, code);
+        return JsonParser_consume_number_exp(str + 1, code);
     } else if(JsonParser_valid_end_of_number(c)) {
         return str;
     } else {
@@ -343,290 +710,857 @@ static inline const char* JsonParser_is_tfn(const char* str, JsonNodeType_t* nod
     return NULL;
 }
 
-JsonParseCode_t JsonParser_parse_document(JsonDocument_t* doc, const char* str) {
-    const char* const start_str = str;
+const char* JsonParser_skip_whitespace(const char* str) {
+    while(JsonParser_is_whitespace(*str))
+        str++;
+    return str;
+}
 
-    JsonNode_t* (*json_allocate_node)(void*) = doc->allocate_node_cb;
-    void* const alloc_data = doc->alloc_data;
+const char* JsonParser_scan_string(const char* str, unsigned int* flags, JsonParseCode_t* code) {
+    const char* error_at = NULL;
+    const char* end = JsonParser_consume_string(str, flags, &error_at, JSONPARSER_DEFAULT_UTF8);
+    if(end == NULL)
+        *code = error_at ? JsonParseCode_invalid_utf8 : JsonParseCode_malformed_string;
+    return end;
+}
 
-    JsonNode_t* top = NULL;
+const char* JsonParser_scan_number(const char* str, JsonParseCode_t* code) {
+    return JsonParser_consume_number(str, code);
+}
 
-    const char* first_char = JsonParser_seek(str);
-    if(first_char == NULL) return JsonParseCode_empty_source;
+const char* JsonParser_skip_value(const char* str, JsonParseCode_t* code) {
+    unsigned long depth = 0ul;
 
-#define state_array     0
-#define state_array_sep 1
-#define state_key       2
-#define state_value     3
-#define state_pair_sep  4
+    for(;;) {
+        str = JsonParser_skip_whitespace(str);
+        const char c = *str;
 
-    int state_stack[JSONPARSER_MAX_DEPTH+1];
-    int* const state_stack_max = state_stack + JSONPARSER_MAX_DEPTH;
-    int* state_pointer = state_stack; // points to current state
+        if(c == '{' || c == '[') {
+            if(++depth > JSONPARSER_MAX_DEPTH) {
+                *code = JsonParseCode_stack_error;
+                return NULL;
+            }
+            str++;
+        } else if(c == '}' || c == ']') {
+            if(depth == 0ul) {
+                *code = JsonParseCode_malformed_source;
+                return NULL;
+            }
+            depth--;
+            str++;
+        } else if(c == ',' || c == ':') {
+            if(depth == 0ul) {
+                *code = JsonParseCode_malformed_source;
+                return NULL;
+            }
+            str++;
+        } else if(c == '"') {
+            unsigned int flags;
+            str = JsonParser_scan_string(str, &flags, code);
+            if(str == NULL) return NULL;
+            str++;
+        } else if(c == '-' || JsonParser_is_numeric(c)) {
+            str = JsonParser_consume_number(str, code);
+            if(str == NULL) return NULL;
+        } else {
+            JsonNodeType_t type;
+            str = JsonParser_is_tfn(str, &type);
+            if(str == NULL) {
+                *code = JsonParseCode_malformed_source;
+                return NULL;
+            }
+        }
 
-    if('[' == *first_char) {
-        JsonNode_t* nodeptr = json_allocate_node(alloc_data);
-        nodeptr->type       = JsonNodeType_array;
-        nodeptr->parent     = top;
-        top = nodeptr;
-        state_stack[0] = state_array;
+        if(depth == 0ul)
+            return str;
     }
-    else if('{' == *first_char) {
-        JsonNode_t* nodeptr = json_allocate_node(alloc_data);;
-        nodeptr->type       = JsonNodeType_object;
-        nodeptr->parent     = top;
-        top = nodeptr;
-        state_stack[0] = state_key;
+}
+
+//
+// where the parser gets its nodes from. nodes kept by JsonParser_reset_document 
+// are used first. with a block allocator, nodes are handed out from the current 
+// block and the callback is only used once the block runs out. the unused rest 
+// of the block is kept on the document for later, but never given to the 
+// dealloc callback since it was never handed out
+//
+typedef struct {
+    JsonNode_t* free;
+    JsonNode_t* next;
+    JsonNode_t* end;
+    JsonParser_alloc_callback alloc_cb;
+    JsonParser_alloc_block_callback block_cb;
+    void* data;
+} JsonParser_node_source_t;
+
+static inline JsonNode_t* JsonParser_new_node(JsonParser_node_source_t* nodes) {
+    JsonNode_t* node;
+
+    if(nodes->free != NULL) {
+        node = nodes->free;
+        nodes->free = node->parent;
+        node->parent = NULL;
+    } else if(nodes->next == nodes->end) {
+        if(nodes->block_cb == NULL) {
+            if(nodes->alloc_cb == NULL)
+                return NULL; // no allocator (such as a clone), only spare nodes can be used
+            return nodes->alloc_cb(nodes->data); // single node callbacks initialize nodes themselves
+        }
+
+        size_t count = JSONPARSER_ALLOC_BLOCK_SIZE;
+        JsonNode_t* block = nodes->block_cb(nodes->data, &count);
+        if(block == NULL || count == 0ul)
+            return NULL;
+
+        nodes->next = block + 1;
+        nodes->end  = block + count;
+        node = block;
+    } else {
+        node = nodes->next++;
     }
-    else {
-        return JsonParseCode_malformed_source;
+
+    node->type = JsonNodeType_none;
+    node->flags = 0u;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.next      = NULL;
+    node->pair.value     = NULL;
+    return node;
+}
+
+static inline void JsonParser_node_source_init(JsonParser_node_source_t* nodes, const JsonDocument_t* doc) {
+    nodes->free     = doc->free_nodes;
+    nodes->next     = doc->block_next;
+    nodes->end      = doc->block_end;
+    nodes->alloc_cb = doc->allocate_node_cb;
+    nodes->block_cb = doc->allocate_block_cb;
+    nodes->data     = doc->alloc_data;
+}
+
+//
+// hand what is left back to the document for the next call
+//
+static inline void JsonParser_keep_spare_nodes(JsonDocument_t* doc, const JsonParser_node_source_t* nodes) {
+    doc->free_nodes = nodes->free;
+    doc->block_next = nodes->next;
+    doc->block_end  = nodes->end;
+}
+
+JsonNode_t* JsonParser_allocate_document_node(JsonDocument_t* doc) {
+    JsonParser_node_source_t nodes;
+    JsonParser_node_source_init(&nodes, doc);
+
+    JsonNode_t* node = JsonParser_new_node(&nodes);
+    JsonParser_keep_spare_nodes(doc, &nodes);
+    if(node == NULL)
+        return NULL;
+
+    // callbacks written before flags and parent links existed leave them alone
+    node->type   = JsonNodeType_none;
+    node->flags  = 0u;
+    node->parent = NULL;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.next      = NULL;
+    node->pair.value     = NULL;
+    return node;
+}
+
+static void JsonParser_clone_measure(const JsonNode_t* node, size_t* num_nodes, size_t* text_len) {
+    const JsonNode_t* iter;
+    (*num_nodes)++;
+
+    switch(node->type) {
+    case JsonNodeType_object:
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next)
+            JsonParser_clone_measure(iter, num_nodes, text_len);
+        break;
+    case JsonNodeType_pair:
+        *text_len += (size_t)(node->pair.key_end - node->pair.key_start);
+        if(node->pair.value != NULL)
+            JsonParser_clone_measure(node->pair.value, num_nodes, text_len);
+        break;
+    case JsonNodeType_array:
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next)
+            JsonParser_clone_measure(iter, num_nodes, text_len);
+        break;
+    case JsonNodeType_element:
+        if(node->elem.item != NULL)
+            JsonParser_clone_measure(node->elem.item, num_nodes, text_len);
+        break;
+    case JsonNodeType_string:
+        *text_len += (size_t)(node->str.end - node->str.start);
+        break;
+    case JsonNodeType_number:
+        *text_len += (size_t)(node->num.end - node->num.start);
+        break;
+    default:
+        break;
     }
+}
 
-    doc->first = top;
+size_t JsonParser_clone_size(const JsonNode_t* node) {
+    if(node == NULL)
+        return 0ul;
 
-    str = first_char + 1; // advance to next character and now start the actual parsing phase
+    size_t num_nodes = 0ul;
+    size_t text_len  = 0ul;
+    JsonParser_clone_measure(node, &num_nodes, &text_len);
+    return num_nodes * sizeof(JsonNode_t) + text_len;
+}
+
+typedef struct {
+    const char* source;
+    JsonNode_t* next_node; // nodes are handed out in the order they are visited
+    char* text;            // start of the text of the clone
+    size_t text_pos;
+} JsonParser_clone_t;
+
+static JsonOffset_t JsonParser_clone_text(JsonParser_clone_t* c, JsonOffset_t start, JsonOffset_t end) {
+    const JsonOffset_t new_start = (JsonOffset_t)c->text_pos;
+    const char* src = c->source + start;
+    const char* const src_end = c->source + end;
+    char* dest = c->text + c->text_pos;
+    while(src < src_end)
+        *(dest++) = *(src++);
+    c->text_pos += (size_t)(end - start);
+    return new_start;
+}
 
-    while(*str && top != NULL && state_pointer >= state_stack) {
-        str = JsonParser_seek(str);
-        if(*str == '\0') {
-            if(state_pointer < state_stack)
-                return JsonParseCode_success;
-            return JsonParseCode_malformed_source;
+//
+// depth-first copy of node, returns the copy
+//
+static JsonNode_t* JsonParser_clone_node(JsonParser_clone_t* c, const JsonNode_t* node, JsonNode_t* parent) {
+    JsonNode_t* copy = c->next_node++;
+    const JsonNode_t* iter;
+    JsonNode_t* prev = NULL;
+
+    copy->type   = node->type;
+    copy->flags  = node->flags;
+    copy->parent = parent;
+    copy->pair.key_start = 0;
+    copy->pair.key_end   = 0;
+    copy->pair.value     = NULL;
+    copy->pair.next      = NULL;
+
+    switch(node->type) {
+    case JsonNodeType_object:
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next) {
+            JsonNode_t* pair = JsonParser_clone_node(c, iter, copy);
+            if(prev == NULL) copy->obj.first = pair;
+            else             prev->pair.next = pair;
+            prev = pair;
         }
+        copy->obj.last = prev;
+        break;
+    case JsonNodeType_pair:
+    {
+        const JsonOffset_t key_len = node->pair.key_end - node->pair.key_start;
+        copy->pair.key_start = JsonParser_clone_text(c, node->pair.key_start, node->pair.key_end);
+        copy->pair.key_end   = copy->pair.key_start + key_len;
+        if(node->pair.value != NULL)
+            copy->pair.value = JsonParser_clone_node(c, node->pair.value, copy);
+        break;
+    }
+    case JsonNodeType_array:
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next) {
+            JsonNode_t* elem = JsonParser_clone_node(c, iter, copy);
+            if(prev == NULL) copy->arr.first = elem;
+            else             prev->elem.next = elem;
+            prev = elem;
+        }
+        copy->arr.last = prev;
+        break;
+    case JsonNodeType_element:
+        if(node->elem.item != NULL)
+            copy->elem.item = JsonParser_clone_node(c, node->elem.item, parent); // items belong to the array
+        break;
+    case JsonNodeType_string:
+        copy->str.start = JsonParser_clone_text(c, node->str.start, node->str.end);
+        copy->str.end   = copy->str.start + (node->str.end - node->str.start);
+        break;
+    case JsonNodeType_number:
+        copy->num.start = JsonParser_clone_text(c, node->num.start, node->num.end);
+        copy->num.end   = copy->num.start + (node->num.end - node->num.start);
+        break;
+    default:
+        break;
+    }
 
-        const int state_current = *state_pointer;
-        const char c = *str;
+    return copy;
+}
 
-        switch(state_current) {
-        case state_array:
-        {
-            if(c == '"') { // string
-                const char* const str_end = JsonParser_consume_string(str);
-                if(str_end == NULL) return JsonParseCode_malformed_string;
+const char* JsonParser_clone_document(
+        JsonDocument_t* dest,
+        const char* doc_source,
+        const JsonNode_t* node,
+        void* buffer,
+        size_t buffer_len) {
 
-                JsonNode_t* elem_node = JsonParser_init_element_node(json_allocate_node(alloc_data), top);
-                JsonNode_t* str_node  = JsonParser_init_string_node(json_allocate_node(alloc_data), top);
-                if(elem_node == NULL || str_node == NULL) return JsonParseCode_allocation_failure;
+    if(doc_source == NULL || node == NULL || buffer == NULL)
+        return NULL;
 
-                elem_node->elem.item = str_node;
-                JsonParser_array_add_element(top, elem_node);
+    size_t num_nodes = 0ul;
+    size_t text_len  = 0ul;
+    JsonParser_clone_measure(node, &num_nodes, &text_len);
 
-                str_node->str.start = 1u + (unsigned int)(str - start_str);
-                str_node->str.end   = (unsigned int)(str_end - start_str);
+    if(num_nodes * sizeof(JsonNode_t) + text_len > buffer_len || text_len > JSONPARSER_MAX_OFFSET)
+        return NULL;
 
-                *(++state_pointer) = state_array_sep;
-                str = str_end + 1; // advance past closing quote
-                break;
-            } else if(c == '-' || JsonParser_is_numeric(c)) { // number
-                JsonParseCode_t code;
-                const char* num_end = JsonParser_consume_number(str, &code);
-                if(num_end == NULL) return code;
-
-                JsonNode_t* elem_node = JsonParser_init_element_node(json_allocate_node(alloc_data), top);
-                JsonNode_t* num_node  = JsonParser_init_number_node(json_allocate_node(alloc_data), top);
-                if(elem_node == NULL || num_node == NULL) return JsonParseCode_allocation_failure;
-
-                elem_node->elem.item = num_node;
-                JsonParser_array_add_element(top, elem_node);
-
-                num_node->num.start = (unsigned int)(str - start_str);
-                num_node->num.end   = (unsigned int)(num_end - start_str);
-                
-                *(++state_pointer) = state_array_sep;
-                str = num_end;
-                break;
-            } else if(c == '[' || c == '{') { // new object or array
-                JsonNode_t* elem_node = JsonParser_init_element_node(json_allocate_node(alloc_data), top);
-                JsonNode_t* nested    = json_allocate_node(alloc_data);
-                if(elem_node == NULL || nested == NULL) return JsonParseCode_allocation_failure;
+    JsonParser_clone_t c;
+    c.source    = doc_source;
+    c.next_node = (JsonNode_t*)buffer;
+    c.text      = (char*)buffer + num_nodes * sizeof(JsonNode_t);
+    c.text_pos  = 0ul;
 
-                elem_node->elem.item = nested;
-                JsonParser_array_add_element(top, elem_node);
+    JsonParser_init_document(dest, NULL, NULL, NULL);
+    dest->first = JsonParser_clone_node(&c, node, NULL);
+    return c.text;
+}
 
-                nested->parent = top;
-                nested->type   = (c == '[') ? JsonNodeType_array : JsonNodeType_object;
-                top = nested;
+//
+// one copy of the parser for every combination of the options that 
+// change how it treats the source (see json-parser-parse.inc)
+//
+#define JSONPARSER_VARIANT        JsonParser_parse_lenient
+#define JSONPARSER_VARIANT_STRICT 0
+#define JSONPARSER_VARIANT_UTF8   0
+#define JSONPARSER_VARIANT_INSITU 0
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_lenient_insitu
+#define JSONPARSER_VARIANT_STRICT 0
+#define JSONPARSER_VARIANT_UTF8   0
+#define JSONPARSER_VARIANT_INSITU 1
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_lenient_utf8
+#define JSONPARSER_VARIANT_STRICT 0
+#define JSONPARSER_VARIANT_UTF8   1
+#define JSONPARSER_VARIANT_INSITU 0
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_lenient_utf8_insitu
+#define JSONPARSER_VARIANT_STRICT 0
+#define JSONPARSER_VARIANT_UTF8   1
+#define JSONPARSER_VARIANT_INSITU 1
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_strict
+#define JSONPARSER_VARIANT_STRICT 1
+#define JSONPARSER_VARIANT_UTF8   0
+#define JSONPARSER_VARIANT_INSITU 0
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_strict_insitu
+#define JSONPARSER_VARIANT_STRICT 1
+#define JSONPARSER_VARIANT_UTF8   0
+#define JSONPARSER_VARIANT_INSITU 1
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_strict_utf8
+#define JSONPARSER_VARIANT_STRICT 1
+#define JSONPARSER_VARIANT_UTF8   1
+#define JSONPARSER_VARIANT_INSITU 0
+#include "json-parser-parse.inc"
+
+#define JSONPARSER_VARIANT        JsonParser_parse_strict_utf8_insitu
+#define JSONPARSER_VARIANT_STRICT 1
+#define JSONPARSER_VARIANT_UTF8   1
+#define JSONPARSER_VARIANT_INSITU 1
+#include "json-parser-parse.inc"
+
+typedef JsonParseCode_t(*JsonParser_variant_t)(JsonDocument_t* doc, const char* base, const char* str, const char** end, const unsigned long max_depth);
 
-                *(++state_pointer) = state_array_sep;
-                *(++state_pointer) = (c == '[') ? state_array : state_key;
-                str++;
-                break;
-            } else if(c == ']') {
-                // should only happen if array is empty
-                top = top->parent;
-                state_pointer--;
-                str++;
-                break;
-            } else {
-                JsonNodeType_t type;
-                const char* tfn_return = JsonParser_is_tfn(str, &type);
-                if(tfn_return) {
-                    JsonNode_t* elem_node = JsonParser_init_element_node(json_allocate_node(alloc_data), top);
-                    JsonNode_t* tfn_node  = JsonParser_init_tfn_node(json_allocate_node(alloc_data), type, top);
-                    if(elem_node == NULL || tfn_node == NULL) return JsonParseCode_allocation_failure;
-
-                    elem_node->elem.item = tfn_node;
-                    JsonParser_array_add_element(top, elem_node);
-
-                    *(++state_pointer) = state_array_sep;
-                    str = tfn_return;
+//
+// indexed by strict | validate_utf8 << 1 | insitu << 2
+//
+static const JsonParser_variant_t JsonParser_variants[8] = {
+    JsonParser_parse_lenient,
+    JsonParser_parse_strict,
+    JsonParser_parse_lenient_utf8,
+    JsonParser_parse_strict_utf8,
+    JsonParser_parse_lenient_insitu,
+    JsonParser_parse_strict_insitu,
+    JsonParser_parse_lenient_utf8_insitu,
+    JsonParser_parse_strict_utf8_insitu,
+};
+
+//
+// insitu is only ever set when str is known to be writable
+//
+static JsonParseCode_t JsonParser_parse(JsonDocument_t* doc, const char* base, const char* str, const int insitu, const char** end, const JsonParserOptions_t* options) {
+    unsigned long max_depth = options->max_depth;
+    if(max_depth == 0ul || max_depth > JSONPARSER_MAX_DEPTH)
+        max_depth = JSONPARSER_MAX_DEPTH;
+
+    const unsigned int variant = 
+            (options->strict ? 1u : 0u) | (options->validate_utf8 ? 2u : 0u) | (insitu ? 4u : 0u);
+    return JsonParser_variants[variant](doc, base, str, end, max_depth);
+}
+
+void JsonParserOptions_init(JsonParserOptions_t* options) {
+    *options = JsonParser_default_options;
+}
+
+static JsonParseCode_t JsonParser_parse_timed(JsonDocument_t* doc, const char* str, const int insitu, const JsonParserOptions_t* options) {
+#ifdef JSONPARSER_COLLECT_STATS
+    if(doc->stats != NULL) {
+        const unsigned long long t = JsonParser_time_ns();
+        JsonParseCode_t code = JsonParser_parse(doc, str, str, insitu, NULL, options);
+        doc->stats->parse_ns += JsonParser_time_ns() - t;
+        doc->stats->documents++;
+        return code;
+    }
+#endif
+    return JsonParser_parse(doc, str, str, insitu, NULL, options);
+}
+
+JsonParseCode_t JsonParser_parse_document(JsonDocument_t* doc, const char* str) {
+    return JsonParser_parse_timed(doc, str, 0, &JsonParser_default_options);
+}
+
+JsonParseCode_t JsonParser_parse_document_insitu(JsonDocument_t* doc, char* str) {
+    return JsonParser_parse_timed(doc, str, 1, &JsonParser_default_options);
+}
+
+JsonParseCode_t JsonParser_parse_document_options(JsonDocument_t* doc, const char* str, const JsonParserOptions_t* options) {
+    return JsonParser_parse_timed(doc, str, 0, options);
+}
+
+JsonParseCode_t JsonParser_parse_document_insitu_options(JsonDocument_t* doc, char* str, const JsonParserOptions_t* options) {
+    return JsonParser_parse_timed(doc, str, 1, options);
+}
+
+//
+// where the text of a node starts and ends in the source it was parsed from
+//
+static JsonOffset_t JsonParser_node_start(const JsonNode_t* node) {
+    switch(node->type) {
+    case JsonNodeType_object:  return node->obj.start;
+    case JsonNodeType_array:   return node->arr.start;
+    case JsonNodeType_pair:    return node->pair.key_start - 1; // opening quote
+    case JsonNodeType_element: return JsonParser_node_start(node->elem.item);
+    case JsonNodeType_string:  return node->str.start - 1;
+    case JsonNodeType_number:  return node->num.start;
+    default:                   return node->lit.start;
+    }
+}
+
+static JsonOffset_t JsonParser_node_end(const JsonNode_t* node) {
+    switch(node->type) {
+    case JsonNodeType_object:  return node->obj.end;
+    case JsonNodeType_array:   return node->arr.end;
+    case JsonNodeType_pair:    return JsonParser_node_end(node->pair.value);
+    case JsonNodeType_element: return JsonParser_node_end(node->elem.item);
+    case JsonNodeType_string:  return node->str.end + 1; // past closing quote
+    case JsonNodeType_number:  return node->num.end;
+    default:                   return node->lit.end;
+    }
+}
+
+static inline JsonNode_t* JsonParser_next_member(const JsonNode_t* member) {
+    return (member->type == JsonNodeType_pair) ? member->pair.next : member->elem.next;
+}
+
+static inline JsonNode_t* JsonParser_member_value(JsonNode_t* member) {
+    return (member->type == JsonNodeType_pair) ? member->pair.value : member->elem.item;
+}
+
+//
+// move every offset in the tree under node by delta (modulo JsonOffset_t)
+//
+static void JsonParser_shift_tree(JsonNode_t* node, const JsonOffset_t delta) {
+    JsonNode_t* iter;
+
+    switch(node->type) {
+    case JsonNodeType_object:
+        node->obj.start += delta;
+        node->obj.end   += delta;
+        for(iter = node->obj.first; iter != NULL; iter = iter->pair.next)
+            JsonParser_shift_tree(iter, delta);
+        break;
+    case JsonNodeType_array:
+        node->arr.start += delta;
+        node->arr.end   += delta;
+        for(iter = node->arr.first; iter != NULL; iter = iter->elem.next)
+            JsonParser_shift_tree(iter->elem.item, delta);
+        break;
+    case JsonNodeType_pair:
+        node->pair.key_start += delta;
+        node->pair.key_end   += delta;
+        JsonParser_shift_tree(node->pair.value, delta);
+        break;
+    case JsonNodeType_element:
+        JsonParser_shift_tree(node->elem.item, delta);
+        break;
+    case JsonNodeType_string:
+        node->str.start += delta;
+        node->str.end   += delta;
+        break;
+    case JsonNodeType_number:
+        node->num.start += delta;
+        node->num.end   += delta;
+        break;
+    default:
+        node->lit.start += delta;
+        node->lit.end   += delta;
+        break;
+    }
+}
+
+//
+// parse one value at str into a detached node. containers go through the 
+// full parser, with their offsets taken from base. options->max_depth is 
+// the nesting left below the container the value goes into
+//
+static JsonNode_t* JsonParser_reparse_value(JsonDocument_t* doc, const char* base, const char* str, const char** end, const JsonParserOptions_t* options, JsonParseCode_t* code) {
+    const char c = *str;
+
+    if(c == '{' || c == '[') {
+        if(options->max_depth == 0ul) {
+            *code = JsonParseCode_stack_error;
+            return NULL;
+        }
+        JsonDocument_t sub = *doc;
+        sub.first = NULL;
+#ifdef JSONPARSER_COLLECT_STATS
+        sub.stats = NULL;
+#endif
+        *code = JsonParser_parse(&sub, base, str, 0, end, options);
+        doc->free_nodes = sub.free_nodes;
+        doc->block_next = sub.block_next;
+        doc->block_end  = sub.block_end;
+
+        if(*code != JsonParseCode_success) {
+            JsonParser_release_document_nodes(doc, sub.first);
+            return NULL;
+        }
+        return sub.first;
+    }
+
+    JsonNode_t* node = JsonParser_allocate_document_node(doc);
+    if(node == NULL) {
+        *code = JsonParseCode_allocation_failure;
+        return NULL;
+    }
+    node->flags  = 0u;
+    node->parent = NULL;
+
+    if(c == '"') {
+        const char* error_at = NULL;
+        const char* str_end = JsonParser_consume_string(str, &node->flags, &error_at, options->validate_utf8);
+        if(str_end == NULL) {
+            *code = error_at ? JsonParseCode_invalid_utf8 : JsonParseCode_malformed_string;
+            JsonParser_recycle_node(doc, node);
+            return NULL;
+        }
+        node->type      = JsonNodeType_string;
+        node->str.start = 1 + (JsonOffset_t)(str - base);
+        node->str.end   = (JsonOffset_t)(str_end - base);
+        *end = str_end + 1;
+    } else if(c == '-' || JsonParser_is_numeric(c)) {
+        const char* num_end = JsonParser_consume_number(str, code);
+        if(num_end == NULL) {
+            JsonParser_recycle_node(doc, node);
+            return NULL;
+        }
+        node->type      = JsonNodeType_number;
+        node->num.start = (JsonOffset_t)(str - base);
+        node->num.end   = (JsonOffset_t)(num_end - base);
+        *end = num_end;
+    } else {
+        JsonNodeType_t type;
+        const char* tfn_end = JsonParser_is_tfn(str, &type);
+        if(tfn_end == NULL) {
+            *code = JsonParseCode_malformed_source;
+            JsonParser_recycle_node(doc, node);
+            return NULL;
+        }
+        node->type      = type;
+        node->lit.start = (JsonOffset_t)(str - base);
+        node->lit.end   = (JsonOffset_t)(tfn_end - base);
+        *end = tfn_end;
+    }
+
+    return node;
+}
+
+//
+// reparse the members of container from the one after prev (or the first) 
+// until the new text lines up with an old member boundary past the edit. 
+// returns 1 if the members were replaced, 0 if the edit reaches beyond 
+// container or the text no longer parses, which the caller handles with 
+// a full parse
+//
+static int JsonParser_reparse_members(
+        JsonDocument_t* doc, const char* base, JsonNode_t* container, JsonNode_t* prev,
+        const JsonOffset_t new_end, const JsonOffset_t delta, const JsonParserOptions_t* options) {
+
+    const int is_object = (container->type == JsonNodeType_object);
+    const char close = is_object ? '}' : ']';
+    const JsonOffset_t old_close = (is_object ? container->obj.end : container->arr.end) - 1;
+
+    JsonNode_t* old = (prev != NULL) ? JsonParser_next_member(prev) : (is_object ? container->obj.first : container->arr.first);
+    JsonNode_t* keep = NULL;  // first old member that survives
+    JsonNode_t* first = NULL; // new members
+    JsonNode_t* last  = NULL;
+
+    const char* str;
+    int expect_member;
+    if(prev != NULL) {
+        str = base + JsonParser_node_end(prev);
+        expect_member = 0;
+    } else {
+        str = base + (is_object ? container->obj.start : container->arr.start) + 1;
+        expect_member = 1;
+    }
+
+    for(;;) {
+        str = JsonParser_skip_whitespace(str);
+        JsonOffset_t pos = (JsonOffset_t)(str - base);
+
+        if(*str == close) {
+            if(pos >= new_end && pos - delta == old_close)
+                break; // the rest of the container was replaced
+            goto fail;
+        }
+
+        if(!expect_member) {
+            if(*str != ',') goto fail;
+            str = JsonParser_skip_whitespace(str + 1);
+            pos = (JsonOffset_t)(str - base);
+            if(*str == close) {
+                if(!options->strict && pos >= new_end && pos - delta == old_close)
                     break;
-                } else {
-                    return JsonParseCode_malformed_array;
-                }
+                goto fail;
             }
         }
-        case state_array_sep:
-            if(c == ']') { // normal array ending
-                top = top->parent;
-                state_pointer--; // state is now state_array
-                state_pointer--; // whatever state came before
-                str++;
+
+        // a member starting where an old one did after the edit means 
+        // everything from here on is unchanged
+        if(pos >= new_end) {
+            while(old != NULL && JsonParser_node_start(old) < pos - delta)
+                old = JsonParser_next_member(old);
+            if(old != NULL && JsonParser_node_start(old) == pos - delta) {
+                keep = old;
                 break;
-            } else if(c == ',') {
-                const char* next = JsonParser_seek(str + 1);
-                if(*next != ']') {    // there is another item in the array
-                    state_pointer--; // get rid of array_sep state
-                    str = next;      // start seeking at whatever this char is
-                    break;
-                } else { // non-compliant array ending
-#ifdef JSONPARSER_NOT_STRICT
-                    top = top->parent;
-                    state_pointer--; // state is now state_array
-                    state_pointer--; // whatever state came before
-                    str = next + 1;
-                    break;
-#else
-                    return JsonParseCode_invalid_array_ending;
-#endif // JSONPARSER_NOT_STRICT
-                }
-            } else {
-                return JsonParseCode_malformed_array;
             }
+        }
 
-        case state_key:
-            if(c == '"') {
-                const char* key_end = JsonParser_consume_string(str);
-                if(key_end == NULL) return JsonParseCode_malformed_object;
-
-                JsonNode_t* pair_node = json_allocate_node(alloc_data);
-                if(pair_node == NULL) return JsonParseCode_allocation_failure;
+        JsonNode_t* member = JsonParser_allocate_document_node(doc);
+        if(member == NULL) goto fail;
+        member->flags  = 0u;
+        member->parent = container;
 
-                pair_node->type = JsonNodeType_pair;
-                pair_node->pair.key_start = 1u + (unsigned int)(str - start_str);
-                pair_node->pair.key_end   = (unsigned int)(key_end - start_str);
-                pair_node->parent = top;
+        JsonParseCode_t code;
+        JsonNode_t* value;
 
-                if(top->obj.first == NULL) top->obj.first = pair_node;
-                else                       top->obj.last->pair.next = pair_node;
-                top->obj.last = pair_node;
+        if(is_object) {
+            member->type = JsonNodeType_pair;
+            member->pair.value = NULL;
+            member->pair.next  = NULL;
 
-                str = key_end + 1;
-                const char* colon = JsonParser_seek(str);
-                if(*colon != ':') return JsonParseCode_malformed_object;
+            const char* error_at = NULL;
+            const char* key_end = (*str == '"') ? JsonParser_consume_string(str, &member->flags, &error_at, options->validate_utf8) : NULL;
+            if(key_end == NULL) {
+                JsonParser_recycle_node(doc, member);
+                goto fail;
+            }
+            member->pair.key_start = 1 + (JsonOffset_t)(str - base);
+            member->pair.key_end   = (JsonOffset_t)(key_end - base);
 
-                str = colon + 1;
-                *state_pointer = state_value;
-                top = pair_node;
-                break;
-            } else if(c == '}') {
-#ifdef JSONPARSER_NOT_STRICT
-                str++;
-                state_pointer--;
-                top = top->parent;
-                break;
-#else
-                return JsonParseCode_malformed_object;
-#endif // JSONPARSER_NOT_STRICT
+            str = JsonParser_skip_whitespace(key_end + 1);
+            if(*str != ':') {
+                JsonParser_recycle_node(doc, member);
+                goto fail;
             }
+            str = JsonParser_skip_whitespace(str + 1);
 
-        case state_value:
-            if(c == '"') {
-                const char* str_end = JsonParser_consume_string(str);
-                if(str_end == NULL) return JsonParseCode_malformed_string;
-                JsonNode_t* str_node  = JsonParser_init_string_node(json_allocate_node(alloc_data), top);
-                if(str_node == NULL) return JsonParseCode_allocation_failure;
+            value = JsonParser_reparse_value(doc, base, str, &str, options, &code);
+            if(value == NULL) {
+                JsonParser_recycle_node(doc, member);
+                goto fail;
+            }
+            value->parent = member;
+            member->pair.value = value;
+        } else {
+            member->type = JsonNodeType_element;
+            member->elem.next = NULL;
 
-                str_node->str.start = 1u + (unsigned int)(str - start_str);
-                str_node->str.end   = (unsigned int)(str_end - start_str);
+            value = JsonParser_reparse_value(doc, base, str, &str, options, &code);
+            if(value == NULL) {
+                JsonParser_recycle_node(doc, member);
+                goto fail;
+            }
+            value->parent = container;
+            member->elem.item = value;
+        }
 
-                top->pair.value = str_node;
-                *state_pointer = state_pair_sep;
-                str = str_end + 1; // advance past closing quote
-                break;
-            } else if(c == '-' || JsonParser_is_numeric(c)) {
-                JsonParseCode_t code;
-                const char* num_end = JsonParser_consume_number(str, &code);
-                if(num_end == NULL) return code;
-                JsonNode_t* num_node  = JsonParser_init_number_node(json_allocate_node(alloc_data), top);
-                if(num_node == NULL) return JsonParseCode_allocation_failure;
-
-                num_node->num.start = (unsigned int)(str - start_str);
-                num_node->num.end   = (unsigned int)(num_end - start_str);
-                
-                top->pair.value = num_node;
-                *state_pointer = state_pair_sep;
-                str = num_end;
-                break;
-            } else if(c == '{' || c == '[') {
-                JsonNode_t* nested_node = json_allocate_node(alloc_data);
-                if(nested_node == NULL) return JsonParseCode_allocation_failure;
-                nested_node->type = (c == '[') ? JsonNodeType_array : JsonNodeType_object;
-                nested_node->parent = top;
-                top->pair.value = nested_node;
-                top = nested_node;
-
-                *state_pointer = state_pair_sep;
-                *(++state_pointer) = (c == '[') ? state_array : state_key;
-                str++;
-                break;
-            } else {
-                JsonNodeType_t type;
-                const char* tfn_ptr = JsonParser_is_tfn(str, &type);
-                if(tfn_ptr == NULL) return JsonParseCode_malformed_object;
-                JsonNode_t* tfn_node = JsonParser_init_tfn_node(json_allocate_node(alloc_data), type, top);
-                if(tfn_node == NULL) return JsonParseCode_allocation_failure;
-
-                top->pair.value = tfn_node;
-                str = tfn_ptr;
-                *state_pointer = state_pair_sep;
+        if(last == NULL)     first = member;
+        else if(is_object)   last->pair.next = member;
+        else                 last->elem.next = member;
+        last = member;
+        expect_member = 0;
+
+        // the same check for a member ending where an old one did
+        pos = (JsonOffset_t)(str - base);
+        if(pos >= new_end) {
+            while(old != NULL && JsonParser_node_end(old) < pos - delta)
+                old = JsonParser_next_member(old);
+            if(old != NULL && JsonParser_node_end(old) == pos - delta) {
+                keep = JsonParser_next_member(old);
                 break;
             }
+        }
+    }
+
+    if((unsigned long long)(str - base) > JSONPARSER_MAX_OFFSET)
+        goto fail;
 
-        case state_pair_sep:
-            if(c == '}') { // normal end of object
-                top = top->parent->parent; // have to get past the pair_node and the object_node
-                state_pointer--;
-                str++;
+    // release the old members being replaced
+    JsonNode_t* iter = (prev != NULL) ? JsonParser_next_member(prev) : (is_object ? container->obj.first : container->arr.first);
+    while(iter != keep) {
+        JsonNode_t* next = JsonParser_next_member(iter);
+        JsonParser_release_document_nodes(doc, iter);
+        iter = next;
+    }
+
+    // link in the new ones
+    JsonNode_t* before = (last != NULL) ? last : prev;
+    if(first == NULL) first = keep;
+    if(prev == NULL) {
+        if(is_object) container->obj.first = first;
+        else          container->arr.first = first;
+    } else if(is_object) {
+        prev->pair.next = first;
+    } else {
+        prev->elem.next = first;
+    }
+
+    if(before != NULL) {
+        if(is_object) before->pair.next = keep;
+        else          before->elem.next = keep;
+    }
+
+    if(keep == NULL) {
+        if(is_object) container->obj.last = before;
+        else          container->arr.last = before;
+    }
+
+    // everything after the edit moves by delta
+    if(delta != 0) {
+        for(iter = keep; iter != NULL; iter = JsonParser_next_member(iter))
+            JsonParser_shift_tree(iter, delta);
+
+        JsonNode_t* node = container;
+        for(;;) {
+            if(node->type == JsonNodeType_object) node->obj.end += delta;
+            else                                  node->arr.end += delta;
+
+            JsonNode_t* parent = node->parent;
+            if(parent == NULL)
                 break;
-            } else if(c == ',') {
-                const char* next = JsonParser_seek(str + 1);
-                if(*next != '}') {
-                    top = top->parent; // get past the pair_node, but keep the object_node
-                    *state_pointer = state_key;
-                    str++;
-                    break;
-                } else {
-#ifdef JSONPARSER_NOT_STRICT
-                    top = top->parent->parent; // move past pair_node and object_node
-                    str = next + 1;
-                    state_pointer--;
-                    break;                    
-#else
-                    return JsonParseCode_invalid_object_ending;
-#endif // JSONPARSER_NOT_STRICT
-                }
+
+            // find the member of the enclosing container holding node
+            JsonNode_t* member;
+            if(parent->type == JsonNodeType_pair) {
+                member = parent;
+                parent = parent->parent;
             } else {
-                return JsonParseCode_malformed_object;
+                for(member = parent->arr.first; member->elem.item != node; member = member->elem.next)
+                    ;
             }
 
-        default:
-            return JsonParseCode_unknown_internal_error;
+            for(iter = JsonParser_next_member(member); iter != NULL; iter = JsonParser_next_member(iter))
+                JsonParser_shift_tree(iter, delta);
+            node = parent;
         }
+    }
+
+    return 1;
 
-        if(state_pointer >= state_stack_max) return JsonParseCode_stack_error;
+fail:
+    while(first != NULL) {
+        JsonNode_t* next = JsonParser_next_member(first);
+        JsonParser_release_document_nodes(doc, first);
+        first = next;
     }
+    return 0;
+}
 
-    return JsonParseCode_success;
+JsonParseCode_t JsonParser_reparse_document(
+        JsonDocument_t* doc,
+        const char* str,
+        size_t edit_start,
+        size_t old_end,
+        size_t new_end) {
+    return JsonParser_reparse_document_options(doc, str, edit_start, old_end, new_end, &JsonParser_default_options);
 }
 
+JsonParseCode_t JsonParser_reparse_document_options(
+        JsonDocument_t* doc,
+        const char* str,
+        size_t edit_start,
+        size_t old_end,
+        size_t new_end,
+        const JsonParserOptions_t* options) {
+
+    JsonNode_t* container = doc->first;
+
+    if(container == NULL || edit_start > old_end || edit_start > new_end || 
+            (unsigned long long)new_end > JSONPARSER_MAX_OFFSET || (unsigned long long)old_end > JSONPARSER_MAX_OFFSET)
+        goto full;
+
+    {
+        const JsonOffset_t start = (JsonOffset_t)edit_start;
+        const JsonOffset_t end   = (JsonOffset_t)old_end;
+        const JsonOffset_t delta = (JsonOffset_t)new_end - (JsonOffset_t)old_end;
+
+        // the edit has to be strictly inside the brackets of the root, 
+        // and the end of the new document has to fit in JsonOffset_t
+        const JsonOffset_t root_end = JsonParser_node_end(container);
+        if(!(JsonParser_node_start(container) < start && end < root_end))
+            goto full;
+        if(new_end > old_end && root_end + delta < root_end)
+            goto full;
+
+        // descend to the smallest container around the edit
+        JsonNode_t* prev;
+        unsigned long depth = 1ul;
+        for(;;) {
+            JsonNode_t* member = (container->type == JsonNodeType_object) ? container->obj.first : container->arr.first;
+            prev = NULL;
+            while(member != NULL && JsonParser_node_end(member) < start) {
+                prev   = member;
+                member = JsonParser_next_member(member);
+            }
+
+            if(member == NULL)
+                break;
+
+            JsonNode_t* value = JsonParser_member_value(member);
+            if((value->type == JsonNodeType_object || value->type == JsonNodeType_array) && 
+                    JsonParser_node_start(value) < start && end < JsonParser_node_end(value)) {
+                container = value;
+                depth++;
+                continue;
+            }
+            break;
+        }
+
+        // containers parsed again start counting their depth from 1
+        JsonParserOptions_t member_options = *options;
+        if(member_options.max_depth == 0ul || member_options.max_depth > JSONPARSER_MAX_DEPTH)
+            member_options.max_depth = JSONPARSER_MAX_DEPTH;
+        member_options.max_depth = (depth < member_options.max_depth) ? member_options.max_depth - depth : 0ul;
+
+        if(JsonParser_reparse_members(doc, str, container, prev, (JsonOffset_t)new_end, delta, &member_options)) {
+            doc->error_offset = 0ul;
+            return JsonParseCode_success;
+        }
+    }
+
+full:
+    JsonParser_reset_document(doc);
+    return JsonParser_parse_document_options(doc, str, options);
+}
@@ -16,6 +16,8 @@ with json-parser. If not, see <https://www.gnu.org/licenses/>.
 
 #include "json-parser-config.h"
 
+#include <stddef.h>
+
 typedef enum {
     JsonNodeType_none,
 
@@ -38,40 +40,80 @@ typedef enum {
 //
 const char* JsonNodeType_as_string(JsonNodeType_t node_type);
 
-typedef struct JsonNode {
-    JsonNodeType_t type;
+//
+// type used for byte offsets into the source of a document
+//
+#ifdef JSONPARSER_LARGE_DOCUMENTS
+typedef unsigned long long JsonOffset_t;
+#define JSONPARSER_MAX_OFFSET 0xFFFFFFFFFFFFFFFFull
+#else
+typedef unsigned int JsonOffset_t;
+#define JSONPARSER_MAX_OFFSET 0xFFFFFFFFu
+#endif // JSONPARSER_LARGE_DOCUMENTS
 
-    struct JsonNode* parent; // not used by all node types
+//
+// per-node flags recorded while parsing. string nodes describe 
+// their contents, pair nodes describe their key
+//
+typedef enum {
+    JsonNodeFlag_escaped   = 0x01, // contains at least one escape sequence
+    JsonNodeFlag_non_ascii = 0x02, // contains at least one byte outside of 7-bit ASCII
+} JsonNodeFlag_t;
 
+typedef struct JsonNode {
+    JsonNodeType_t type;
+    unsigned int flags; // JsonNodeFlag_t bits
+
+    //
+    // the object for pairs, the array for elements and array items, 
+    // the pair for object values and NULL for the top-level node
+    //
+    struct JsonNode* parent;
+
+    //
+    // every node records where its text is in the source. the spans of 
+    // containers and literals are only set by the text parser and are 
+    // 0 in trees built any other way (decoded or cloned). the editing 
+    // functions clear them on every container whose text they change
+    //
     union {
         struct {
             struct JsonNode* first;
             struct JsonNode* last;
+            JsonOffset_t start; // offset of the opening brace
+            JsonOffset_t end;   // offset just past the closing brace
         } obj;
 
         struct {
-            unsigned int key_start;
-            unsigned int key_end;
+            JsonOffset_t key_start;
+            JsonOffset_t key_end;
             struct JsonNode* value;
             struct JsonNode* next;
         } pair;
 
         struct {
-            unsigned int start;
-            unsigned int end;
+            JsonOffset_t start;
+            JsonOffset_t end;
         } str;
 
         struct {
-            unsigned int start;
-            unsigned int end;
+            JsonOffset_t start;
+            JsonOffset_t end;
         } num;
 
         struct {
             struct JsonNode* first;
             //struct JsonNode* next;
             struct JsonNode* last;
+            JsonOffset_t start; // offset of the opening bracket
+            JsonOffset_t end;   // offset just past the closing bracket
         } arr;
 
+        struct {
+            JsonOffset_t start;
+            JsonOffset_t end;
+        } lit; // true, false and null
+
         struct {
             struct JsonNode* item;
             struct JsonNode* next;
@@ -80,14 +122,49 @@ typedef struct JsonNode {
 
 } JsonNode_t;
 
+#ifdef JSONPARSER_COLLECT_STATS
+
+//
+// statistics gathered by JsonParser_parse_document and JsonParser_delete_document.
+// counters accumulate over every document parsed while attached
+//
+typedef struct JsonParseStats {
+    unsigned long nodes[JsonNodeType_null + 1]; // nodes allocated, indexed by JsonNodeType_t
+    unsigned long documents;      // parse calls
+    unsigned long bytes_consumed; // source bytes consumed by the parser
+    unsigned long max_depth;      // deepest nesting of objects/arrays seen
+    unsigned long string_bytes;   // raw bytes inside strings and keys
+    unsigned long number_bytes;   // raw bytes of numbers
+    unsigned long escapes;        // escape sequences in strings and keys
+    unsigned long long parse_ns;  // time spent parsing
+    unsigned long long delete_ns; // time spent deleting documents
+} JsonParseStats_t;
+
+#endif // JSONPARSER_COLLECT_STATS
+
 typedef JsonNode_t*(*JsonParser_alloc_callback)(void* const alloc_data);
 typedef void(*JsonParser_dealloc_callback)(void* const alloc_data, JsonNode_t* node);
 
+//
+// allocate a contiguous block of nodes. count holds the number of nodes the 
+// parser would like (JSONPARSER_ALLOC_BLOCK_SIZE) and must be set to the number 
+// of nodes actually returned. nodes do not need to be initialized
+//
+typedef JsonNode_t*(*JsonParser_alloc_block_callback)(void* const alloc_data, size_t* count);
+
 typedef struct {
     JsonNode_t* first;
     JsonParser_alloc_callback allocate_node_cb;
+    JsonParser_alloc_block_callback allocate_block_cb; // used instead of allocate_node_cb if set
     JsonParser_dealloc_callback dealloc_node_cb;
+    JsonNode_t* free_nodes; // spare nodes (see JsonParser_reset_document), used before the allocator
+    JsonNode_t* block_next; // rest of the current block from allocate_block_cb, never handed out
+    JsonNode_t* block_end;
     void* alloc_data;
+    size_t error_offset; // byte offset where parsing stopped if JsonParser_parse_document fails
+#ifdef JSONPARSER_COLLECT_STATS
+    JsonParseStats_t* stats;
+#endif
 } JsonDocument_t;
 
 #ifdef JSONPARSER_HAS_MALLOC
@@ -114,10 +191,89 @@ void JsonParser_init_document(
         void* alloc_data);
 
 //
-// destroy nodes used for JSON parsing
+// initialize documents that get their nodes in blocks. the parser bump-allocates 
+// out of each block and only calls allocate_block_cb when a block is used up.
+// the unused rest of the last block is kept for the next parse into the same 
+// document. delete_node_cb only gets nodes that were handed out, the unused 
+// rest stays with the allocator. delete_node_cb may be NULL if the nodes are 
+// released all at once by the allocator
+//
+void JsonParser_init_document_block(
+        JsonDocument_t* doc,
+        JsonParser_dealloc_callback delete_node_cb,
+        JsonParser_alloc_block_callback allocate_block_cb,
+        void* alloc_data);
+
+//
+// destroy nodes used for JSON parsing.
+// does nothing but forget the tree if the document has no dealloc callback
 //
 void JsonParser_delete_document(JsonDocument_t* doc);
 
+//
+// forget the parsed tree but keep its nodes for the next parse, which 
+// only asks the allocator for nodes once these are used up. parsing a 
+// stream of similar documents with reset in between stops allocating 
+// after the first few. JsonParser_delete_document releases kept nodes
+//
+void JsonParser_reset_document(JsonDocument_t* doc);
+
+//
+// take one node from the document's allocator for building a tree without 
+// the parser (as the binary decoders do). nodes kept by JsonParser_reset_document 
+// are used first and the rest of a block is kept for later calls. 
+// the node has type JsonNodeType_none, no flags, no parent and zeroed pair 
+// fields, whichever allocator it came from. returns NULL if allocation fails
+//
+JsonNode_t* JsonParser_allocate_document_node(JsonDocument_t* doc);
+
+//
+// give the nodes of a subtree that is no longer linked into the tree back 
+// to the document, where they are used again like the ones kept by 
+// JsonParser_reset_document. node may also be a pair or an element, which 
+// is released together with its value
+//
+void JsonParser_release_document_nodes(JsonDocument_t* doc, JsonNode_t* node);
+
+//
+// number of bytes JsonParser_clone_document needs for the tree under node
+//
+size_t JsonParser_clone_size(const JsonNode_t* node);
+
+//
+// copy the tree under node (which may be a subtree) and the text it 
+// references into buffer, which must be aligned for JsonNode_t (as from 
+// malloc). the nodes come first, in depth-first order, followed by the 
+// text they reference packed together in the same order. this also 
+// compacts a tree that has been edited or built from scattered nodes.
+// dest is initialized with no allocator and its nodes live in buffer, 
+// so it is released by freeing buffer. JsonParser_delete_document on it 
+// only forgets the tree.
+// returns the doc_source of the copy, or NULL if buffer is smaller than 
+// JsonParser_clone_size(node)
+//
+const char* JsonParser_clone_document(
+        JsonDocument_t* dest,
+        const char* doc_source,
+        const JsonNode_t* node,
+        void* buffer,
+        size_t buffer_len);
+
+#ifdef JSONPARSER_COLLECT_STATS
+
+//
+// zero all counters in the given stats structure
+//
+void JsonParseStats_init(JsonParseStats_t* stats);
+
+//
+// gather statistics for every parse and delete of doc into stats. 
+// pass NULL to stop gathering statistics
+//
+void JsonParser_attach_stats(JsonDocument_t* doc, JsonParseStats_t* stats);
+
+#endif // JSONPARSER_COLLECT_STATS
+
 typedef enum {
     JsonParseCode_success = 0,
 
@@ -136,6 +292,8 @@ typedef enum {
     JsonParseCode_unknown_internal_error,
 
     JsonParseCode_empty_source,
+    JsonParseCode_invalid_utf8, // only reported when validating UTF-8 (see JsonParserOptions_t)
+    JsonParseCode_offset_overflow, // source is too large for JsonOffset_t
 } JsonParseCode_t;
 
 //
@@ -144,6 +302,103 @@ typedef enum {
 const char* JsonParseCode_as_string(JsonParseCode_t c);
 
 //
-// meat of the library
+// parser behaviour that can be chosen per call, so strict parsing of 
+// external input and lenient parsing of internal files can share a 
+// binary. JsonParser_parse_document uses the defaults from 
+// json-parser-config.h, which JsonParserOptions_init fills in. every 
+// combination has its own copy of the parser, so options cost nothing 
+// while parsing
+//
+typedef struct JsonParserOptions {
+    int strict;              // reject trailing ,] and ,} (lenient with JSONPARSER_NOT_STRICT)
+    int validate_utf8;       // report malformed UTF-8 in strings (JSONPARSER_VALIDATE_UTF8)
+    unsigned long max_depth; // nesting limit, 0 or anything above JSONPARSER_MAX_DEPTH means JSONPARSER_MAX_DEPTH
+} JsonParserOptions_t;
+
+void JsonParserOptions_init(JsonParserOptions_t* options);
+
+//
+// meat of the library.
+// on failure, doc->error_offset holds the offset of the byte where the error was detected
 //
 JsonParseCode_t JsonParser_parse_document(JsonDocument_t* doc, const char* str);
+
+//
+// parse a document from a mutable buffer, in place. strings (and keys) are 
+// unescaped inside of str while parsing and null-terminated, so str + start 
+// of any string or pair node is a ready-to-use C string and no JsonNodeFlag_escaped 
+// flags are left in the tree. escape sequences are decoded as by JsonString_copy_utf8.
+// numbers are not null-terminated. the contents of str are undefined if parsing fails
+//
+JsonParseCode_t JsonParser_parse_document_insitu(JsonDocument_t* doc, char* str);
+
+//
+// same as JsonParser_parse_document and JsonParser_parse_document_insitu 
+// with the given options instead of the defaults
+//
+JsonParseCode_t JsonParser_parse_document_options(JsonDocument_t* doc, const char* str, const JsonParserOptions_t* options);
+JsonParseCode_t JsonParser_parse_document_insitu_options(JsonDocument_t* doc, char* str, const JsonParserOptions_t* options);
+
+//
+// bring a document parsed with JsonParser_parse_document up to date after 
+// an edit of its source. the bytes between edit_start and old_end of the 
+// old source were replaced by those between edit_start and new_end of str. 
+// only the members of the smallest container around the edit are parsed 
+// again, from the last one before the edit until the new text lines up 
+// with a member of the old tree, and every other node is kept. finding 
+// the edit walks the member lists down to it and moving the offsets after 
+// it touches every node behind it, but neither parses anything. str must 
+// not be parsed in place. edits that reach outside of the root, change 
+// the structure around them or make the text invalid fall back to a full 
+// parse, so the result is always the same as JsonParser_parse_document(doc, str)
+//
+JsonParseCode_t JsonParser_reparse_document(
+        JsonDocument_t* doc,
+        const char* str,
+        size_t edit_start,
+        size_t old_end,
+        size_t new_end);
+
+//
+// same as JsonParser_reparse_document for a document parsed with 
+// JsonParser_parse_document_options. the members are parsed again with 
+// the same options, so the result is always the same as 
+// JsonParser_parse_document_options(doc, str, options)
+//
+JsonParseCode_t JsonParser_reparse_document_options(
+        JsonDocument_t* doc,
+        const char* str,
+        size_t edit_start,
+        size_t old_end,
+        size_t new_end,
+        const JsonParserOptions_t* options);
+
+//
+// decode a single escape sequence, src points at the backslash. 
+// \uXXXX escapes and surrogate pairs are written out as UTF-8, unpaired 
+// surrogates as U+FFFD, and malformed escapes are dropped. never writes more 
+// bytes than it consumes, so dest may alias src.
+// returns the location just past the escape sequence and adds the number 
+// of bytes written out to dest_len
+//
+const char* JsonParser_decode_escape(const char* src, const char* end, char* dest, size_t* dest_len);
+
+//
+// the parser's scanners, for reading null-terminated JSON text without
+// building a tree. they return the location just past what was scanned,
+// or NULL with code set to why it was rejected
+//
+
+// returns str advanced past any whitespace (never NULL)
+const char* JsonParser_skip_whitespace(const char* str);
+
+// str points at the opening quote. returns the closing quote and sets
+// flags to the JsonNodeFlag_t bits a string node would get
+const char* JsonParser_scan_string(const char* str, unsigned int* flags, JsonParseCode_t* code);
+
+// a number has to be followed by whitespace, ',', '}' or ']' like in the parser
+const char* JsonParser_scan_number(const char* str, JsonParseCode_t* code);
+
+// skips whitespace and one complete value. containers are only checked
+// for balanced brackets, their contents are scanned but not validated
+const char* JsonParser_skip_value(const char* str, JsonParseCode_t* code);
@@ -1,11 +1,11 @@
 #include "json-parser.h"
 #include "json-parser-util.h"
-
-#include <sys/time.h>
+#include "json-parser-mmap.h"
 
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define CHUNK_SIZE 4096
 
@@ -47,12 +47,16 @@ void dealloc_custom(void* const alloc_data, JsonNode_t* node) {
 
 int main(int argc, char** argv) {
 
-    if(argc != 2) {
-        printf("usage:\n    ./main <JSON file>\n\n");
+    int use_mmap = (argc == 3 && strcmp(argv[1], "--mmap") == 0);
+
+    if(argc != 2 && !use_mmap) {
+        printf("usage:\n    ./main [--mmap] <JSON file>\n\n");
         fflush(stdout);
         exit(EXIT_SUCCESS);
     }
 
+    const char* filename = argv[argc - 1];
+
     bump_allocator_t bump;
 
     JsonDocument_t doc;
@@ -61,10 +65,33 @@ int main(int argc, char** argv) {
             dealloc_custom,
             alloc_custom, &bump);
 
-    char* json;
+#ifdef JSONPARSER_COLLECT_STATS
+    JsonParseStats_t stats;
+    JsonParseStats_init(&stats);
+    JsonParser_attach_stats(&doc, &stats);
+#endif
 
-    {
-        FILE* fptr = fopen(argv[1], "rb");
+    const char* json;
+    char* json_buffer = NULL;
+
+#ifdef JSONPARSER_HAS_MMAP
+    JsonMappedFile_t mapped_file = { NULL, 0ul, 0ul };
+#endif
+
+    if(use_mmap) {
+#ifdef JSONPARSER_HAS_MMAP
+        // parse straight out of the page cache, no copy of the file is made
+        if(!JsonMappedFile_open(&mapped_file, filename))
+            return 1;
+
+        printf("file size : %lu bytes (mapped)\n", mapped_file.size);
+        json = mapped_file.data;
+#else
+        printf("built without JSONPARSER_HAS_MMAP\n");
+        return 1;
+#endif
+    } else {
+        FILE* fptr = fopen(filename, "rb");
         if(fptr == NULL)
             return 1;
 
@@ -74,23 +101,21 @@ int main(int argc, char** argv) {
         printf("file size : %lu bytes\n", l_size);
 
         rewind(fptr);
-        json = (char*)malloc(l_size + 1);
+        json_buffer = (char*)malloc(l_size + 1);
 
         size_t rd_size = 0ul;
 
         while(l_size) {
-            size_t chunk_size = fread(json + rd_size, 1, l_size, fptr);
+            size_t chunk_size = fread(json_buffer + rd_size, 1, l_size, fptr);
             rd_size += chunk_size;
             l_size  -= chunk_size;
         }
 
         fclose(fptr);
-        json[rd_size] = '\0';
+        json_buffer[rd_size] = '\0';
+        json = json_buffer;
     }
 
-    size_t num_iters = 1;
-    size_t total_time = 0ul;
-
     bump.first = new_node_chunk();
     bump.last = bump.first;
 
@@ -141,6 +166,26 @@ int main(int argc, char** argv) {
 
     JsonParser_delete_document(&doc);
 
+#ifdef JSONPARSER_COLLECT_STATS
+    {
+        unsigned long total_nodes = 0ul;
+        int t;
+        for(t = JsonNodeType_none; t <= JsonNodeType_null; t++) {
+            if(stats.nodes[t] == 0ul) continue;
+            printf("%-8s nodes : %lu\n", JsonNodeType_as_string((JsonNodeType_t)t), stats.nodes[t]);
+            total_nodes += stats.nodes[t];
+        }
+
+        printf("total nodes    : %lu (%lu chunks of %d)\n", total_nodes, chunk_count, CHUNK_SIZE);
+        printf("bytes consumed : %lu\n", stats.bytes_consumed);
+        printf("max depth      : %lu\n", stats.max_depth);
+        printf("string bytes   : %lu (%lu escapes)\n", stats.string_bytes, stats.escapes);
+        printf("number bytes   : %lu\n", stats.number_bytes);
+        printf("parse time     : %llu ns\n", stats.parse_ns);
+        printf("delete time    : %llu ns\n", stats.delete_ns);
+    }
+#endif
+
     // remove blocks belonging to bump allocator
     node_chunk_t* chunk_iter = bump.first;
     while(chunk_iter) {
@@ -150,7 +195,10 @@ int main(int argc, char** argv) {
     }
 
     // remove space allocated for source
-    free(json);
+    free(json_buffer);
+#ifdef JSONPARSER_HAS_MMAP
+    JsonMappedFile_close(&mapped_file);
+#endif
 
     return 0;
 }
@@ -169,6 +217,7 @@ JsonNode_t* alloc_custom(void* const alloc_data) {
 
     JsonNode_t* node = nodes->current_node++;
     node->type = JsonNodeType_none;
+    node->flags = 0u;
     node->pair.key_start = 0;
     node->pair.key_end   = 0;
     node->pair.next      = NULL;
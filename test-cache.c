@@ -0,0 +1,264 @@
+//
+// concurrent stress test for json-parser-cache
+//
+// many threads look up a set of documents in one JsonCache_t whose budget
+// only holds part of them, so hits, misses, concurrent inserts of the same
+// source and evictions of entries still in use all happen at once. every
+// entry handed out is compared with a reference parse of its source, some
+// are held on to across later lookups, and one thread clears the cache
+// now and then. afterwards every allocation made through the cache must
+// have been freed. build with -pthread and run under -fsanitize=thread or
+// -fsanitize=address to also catch data races and use after free.
+//
+// usage: ./test-cache [threads] [lookups]
+//
+
+#define _POSIX_C_SOURCE 200809L // pthreads
+
+#include "json-parser.h"
+#include "json-parser-util.h"
+#include "json-parser-cache.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_DOCS    48
+#define NUM_HOT     8    // documents most lookups go to
+#define NUM_HELD    4    // entries each thread keeps while looking up more
+#define CLEAR_EVERY 1000 // lookups between clears in the first thread
+
+static const char broken_source[] = "{\"broken\":[1,2";
+
+typedef struct {
+    atomic_ulong allocs;
+    atomic_ulong frees;
+} counters_t;
+
+static void* cache_alloc(void* const alloc_data, size_t size) {
+    counters_t* counters = (counters_t*)alloc_data;
+    void* ptr = malloc(size);
+    if(ptr != NULL)
+        atomic_fetch_add_explicit(&counters->allocs, 1ul, memory_order_relaxed);
+    return ptr;
+}
+
+static void cache_free(void* const alloc_data, void* ptr) {
+    counters_t* counters = (counters_t*)alloc_data;
+    atomic_fetch_add_explicit(&counters->frees, 1ul, memory_order_relaxed);
+    free(ptr);
+}
+
+typedef struct {
+    char* src;
+    size_t len;
+    JsonDocument_t doc; // reference parse, only read by the threads
+} source_t;
+
+typedef struct {
+    JsonCache_t* cache;
+    const source_t* sources;
+    size_t lookups;
+    uint64_t seed;
+    int clears;
+    unsigned long errors;
+} worker_t;
+
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void check_entry(worker_t* w, const JsonCacheEntry_t* entry, const source_t* src) {
+    if(entry->doc_source == NULL || entry->doc.first == NULL) {
+        w->errors++;
+        return;
+    }
+    if(!JsonNode_equal(entry->doc_source, entry->doc.first, src->src, src->doc.first, 0))
+        w->errors++;
+    if(JsonNode_hash(entry->doc_source, entry->doc.first, 0) != JsonNode_hash(src->src, src->doc.first, 0))
+        w->errors++;
+}
+
+static void* worker_thread(void* arg) {
+    worker_t* w = (worker_t*)arg;
+    const JsonCacheEntry_t* held[NUM_HELD] = { NULL };
+    size_t i;
+
+    for(i = 0ul; i < w->lookups; i++) {
+        const uint64_t r = next_random(&w->seed);
+        JsonParseCode_t code;
+
+        if(r % 64u == 0u) {
+            if(JsonCache_parse(w->cache, broken_source, sizeof(broken_source) - 1ul, &code) != NULL || code == JsonParseCode_success)
+                w->errors++;
+            continue;
+        }
+
+        const size_t idx = (r % 4u != 0u) ? (size_t)(r >> 8) % NUM_HOT : (size_t)(r >> 8) % NUM_DOCS;
+        const source_t* src = &w->sources[idx];
+
+        const JsonCacheEntry_t* entry = JsonCache_parse(w->cache, src->src, src->len, &code);
+        if(entry == NULL || code != JsonParseCode_success) {
+            w->errors++;
+            continue;
+        }
+        check_entry(w, entry, src);
+
+        // keep the entry for a while, it may be evicted or cleared meanwhile
+        const size_t slot = i % NUM_HELD;
+        JsonCache_release(w->cache, held[slot]);
+        held[slot] = entry;
+
+        if(w->clears && i % CLEAR_EVERY == CLEAR_EVERY - 1ul)
+            JsonCache_clear(w->cache);
+    }
+
+    for(i = 0ul; i < NUM_HELD; i++)
+        JsonCache_release(w->cache, held[i]);
+    return NULL;
+}
+
+static JsonNode_t* test_alloc(void* const alloc_data) {
+    (void)alloc_data;
+    JsonNode_t* node = (JsonNode_t*)malloc(sizeof(JsonNode_t));
+    if(node == NULL)
+        return NULL;
+    node->type = JsonNodeType_none;
+    node->flags = 0u;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.next      = NULL;
+    node->pair.value     = NULL;
+    return node;
+}
+
+static void test_dealloc(void* const alloc_data, JsonNode_t* node) {
+    (void)alloc_data;
+    free(node);
+}
+
+//
+// documents of different shapes and sizes, the larger ones take up
+// several times the space of the small ones in the cache
+//
+static char* build_source(int n, size_t* len) {
+    const size_t cap = 1ul << 16;
+    char* buf = (char*)malloc(cap);
+    size_t pos = 0ul;
+
+    pos += (size_t)snprintf(buf + pos, cap - pos,
+            "{\"id\":%d,\"name\":\"doc \\\"%d\\\" \\u00e9\",\"ratio\":%d.%03d,\"tags\":[", n, n, n % 7, n * 37 % 1000);
+
+    const int items = 4 + (n % 6) * (n % 6) * 8;
+    int i;
+    for(i = 0; i < items; i++)
+        pos += (size_t)snprintf(buf + pos, cap - pos, "%s{\"k\":\"t%d\",\"v\":[%d,-%d.5,true,null]}", i ? "," : "", i, i * n, i);
+
+    pos += (size_t)snprintf(buf + pos, cap - pos, "],\"last\":%s}", (n & 1) ? "false" : "\"\"");
+    *len = pos;
+    return buf;
+}
+
+int main(int argc, char** argv) {
+    const size_t num_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8ul;
+    const size_t lookups     = argc > 2 ? strtoul(argv[2], NULL, 10) : 5000ul;
+    if(num_threads == 0ul || lookups == 0ul) {
+        printf("usage:\n    ./test-cache [threads] [lookups]\n\n");
+        return EXIT_FAILURE;
+    }
+
+    source_t sources[NUM_DOCS];
+    size_t total = 0ul;
+    int i;
+    for(i = 0; i < NUM_DOCS; i++) {
+        sources[i].src = build_source(i, &sources[i].len);
+        total += sources[i].len;
+
+        JsonParser_init_document(&sources[i].doc, test_dealloc, test_alloc, NULL);
+        JsonParseCode_t code = JsonParser_parse_document(&sources[i].doc, sources[i].src);
+        if(code != JsonParseCode_success) {
+            printf("failed to parse document %d : %s\n", i, JsonParseCode_as_string(code));
+            return EXIT_FAILURE;
+        }
+    }
+
+    counters_t counters;
+    atomic_init(&counters.allocs, 0ul);
+    atomic_init(&counters.frees, 0ul);
+
+    // entries hold the source and its tree, so this only fits part of the documents
+    JsonCache_t cache;
+    if(!JsonCache_init(&cache, 16ul, total * 2ul, cache_alloc, cache_free, &counters)) {
+        printf("failed to set up cache\n");
+        return EXIT_FAILURE;
+    }
+
+    worker_t* workers = (worker_t*)malloc(num_threads * sizeof(worker_t));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+
+    size_t t;
+    for(t = 0ul; t < num_threads; t++) {
+        workers[t].cache   = &cache;
+        workers[t].sources = sources;
+        workers[t].lookups = lookups;
+        workers[t].seed    = 0x9e3779b97f4a7c15ull * (t + 1ul);
+        workers[t].clears  = (t == 0ul);
+        workers[t].errors  = 0ul;
+        if(pthread_create(&threads[t], NULL, worker_thread, &workers[t]) != 0) {
+            printf("failed to start thread %lu\n", (unsigned long)t);
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned long failures = 0ul;
+    for(t = 0ul; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        if(workers[t].errors != 0ul) {
+            printf("thread %lu : %lu errors\n", (unsigned long)t, workers[t].errors);
+            failures++;
+        }
+    }
+
+    if(cache.hits + cache.misses != num_threads * lookups) {
+        printf("%lu hits and %lu misses for %lu lookups\n", cache.hits, cache.misses, (unsigned long)(num_threads * lookups));
+        failures++;
+    }
+    if(cache.used > cache.budget) {
+        printf("%lu bytes cached, budget is %lu\n", (unsigned long)cache.used, (unsigned long)cache.budget);
+        failures++;
+    }
+
+    printf("%lu threads x %lu lookups over %d documents : %lu hits, %lu misses, %lu evictions\n",
+            (unsigned long)num_threads, (unsigned long)lookups, NUM_DOCS, cache.hits, cache.misses, cache.evictions);
+
+    JsonCache_destroy(&cache);
+
+    const unsigned long allocs = atomic_load(&counters.allocs);
+    const unsigned long frees  = atomic_load(&counters.frees);
+    if(allocs != frees) {
+        printf("%lu allocations but %lu frees\n", allocs, frees);
+        failures++;
+    }
+    if(cache.evictions == 0ul) {
+        printf("nothing was evicted, the budget is too large\n");
+        failures++;
+    }
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+
+    free(threads);
+    free(workers);
+    for(i = 0; i < NUM_DOCS; i++) {
+        JsonParser_delete_document(&sources[i].doc);
+        free(sources[i].src);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
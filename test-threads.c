@@ -0,0 +1,340 @@
+//
+// concurrent read test for json-parser-util
+//
+// parses one configuration-like document, builds a JsonObjIndex_t over
+// its top-level object and then lets many threads read the shared
+// document at once through every function of json-parser-util.h. each
+// thread folds what it reads into a digest that must match the one
+// computed before the threads were started. build with -pthread and run
+// under -fsanitize=thread to also catch data races.
+//
+// usage: ./test-threads [threads] [rounds]
+//
+
+#define _POSIX_C_SOURCE 200809L // pthreads
+
+#include "json-parser.h"
+#include "json-parser-util.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_KEYS   512
+#define NUM_ROUTES 64
+
+typedef struct {
+    const char* src;
+    JsonNode_t* root;
+    const JsonObjIndex_t* index;
+    size_t rounds;
+    size_t offset;   // first key looked up, differs per thread
+    size_t scratch_len;
+    uint64_t digest;
+    unsigned long errors;
+} reader_t;
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ull;
+}
+
+static uint64_t mix_bytes(uint64_t h, const char* s, size_t len) {
+    size_t i;
+    for(i = 0ul; i < len; i++)
+        h = mix(h, (unsigned char)s[i]);
+    return h;
+}
+
+//
+// reads a string through every string accessor
+//
+static uint64_t read_string(reader_t* r, const JsonString_t* str, char* scratch, uint64_t h) {
+    const unsigned long size = JsonString_size(str);
+    h = mix(h, size);
+
+    size_t len = JsonString_copy(str, scratch);
+    if(len > size) r->errors++;
+    h = mix_bytes(h, scratch, len);
+
+    len = JsonString_copy_utf8(str, scratch);
+    if(len > size) r->errors++;
+    h = mix_bytes(h, scratch, len);
+
+    size_t view_len;
+    const char* view = JsonString_view(str, scratch, &view_len);
+    h = mix_bytes(h, view, view_len);
+
+    JsonDateTime_t dt;
+    JsonDateTime_init_default(&dt);
+    if(JsonDateTime_from_json_string(&dt, str)) {
+        char out[JSONDATETIME_LEN + 1];
+        if(!JsonDateTime_to_string(&dt, out, JSONDATETIME_LEN))
+            r->errors++;
+        out[JSONDATETIME_LEN] = '\0';
+
+        JsonDateTime_t again;
+        if(!JsonDateTime_from_cstring(&again, out) || memcmp(&dt, &again, sizeof(dt)) != 0)
+            r->errors++;
+        h = mix_bytes(h, out, JSONDATETIME_LEN);
+    }
+    return h;
+}
+
+static uint64_t read_value(reader_t* r, JsonNode_t* node, char* scratch, uint64_t h) {
+    h = mix(h, (uint64_t)node->type);
+
+    switch(node->type) {
+    case JsonNodeType_object: {
+        JsonObjIter_t iter;
+        if(!JsonObjIter_init(&iter, node))
+            r->errors++;
+        if(JsonObj_first_field(node) != JsonObjIter_current(&iter))
+            r->errors++;
+
+        while(JsonObjIter_current(&iter) != NULL) {
+            JsonNode_t* pair = JsonObjIter_current(&iter);
+
+            JsonString_t key;
+            if(!JsonPair_key(pair, r->src, &key))
+                r->errors++;
+            h = read_string(r, &key, scratch, h);
+
+            // keys in this document have no escapes, so copies are names
+            const size_t len = JsonString_copy_utf8(&key, scratch);
+            scratch[len] = '\0';
+            if(!JsonObjIter_field_name_matches(&iter, r->src, scratch) ||
+                    JsonObj_field_by_name(r->src, node, scratch) != pair)
+                r->errors++;
+
+            h = read_value(r, JsonPair_field(pair), scratch, h);
+            JsonObjIter_next(&iter);
+        }
+        break;
+    }
+    case JsonNodeType_array: {
+        JsonArrIter_t iter;
+        if(!JsonArrIter_init(&iter, node))
+            r->errors++;
+
+        size_t idx = 0ul;
+        JsonNode_t* item;
+        while((item = JsonArrIter_current(&iter)) != NULL) {
+            if(JsonArr_index(node, idx) != item)
+                r->errors++;
+            h = read_value(r, item, scratch, h);
+            idx++;
+            JsonArrIter_next(&iter);
+        }
+        h = mix(h, idx);
+        break;
+    }
+    case JsonNodeType_string: {
+        JsonString_t str;
+        if(!JsonString_init(&str, r->src, node))
+            r->errors++;
+        h = read_string(r, &str, scratch, h);
+        break;
+    }
+    case JsonNodeType_number: {
+        JsonNumber_t num;
+        if(!JsonNumber_convert_from_json_string(r->src, node, &num))
+            r->errors++;
+        h = mix(h, (uint64_t)num.type);
+
+        double d;
+        if(!JsonNumber_to_double(r->src, node, &d))
+            r->errors++;
+        h = mix(h, (uint64_t)(int64_t)(d * 1000.0));
+
+        int64_t i;
+        if(JsonNumber_to_int64(r->src, node, &i))
+            h = mix(h, (uint64_t)i);
+        break;
+    }
+    default:
+        break;
+    }
+    return h;
+}
+
+static uint64_t read_document(reader_t* r, char* scratch) {
+    uint64_t h = read_value(r, r->root, scratch, 0xcbf29ce484222325ull);
+
+    h = mix(h, JsonNode_hash(r->src, r->root, 0));
+    h = mix(h, JsonNode_hash(r->src, r->root, 1));
+    if(!JsonNode_equal(r->src, r->root, r->src, r->root, 0) ||
+            !JsonNode_equal(r->src, r->root, r->src, r->root, 1))
+        r->errors++;
+
+    //
+    // lookups through the shared index, starting at a different key in
+    // every thread. summed so the order does not change the result
+    //
+    uint64_t sum = 0ull;
+    size_t k;
+    for(k = 0ul; k < NUM_KEYS; k++) {
+        char name[16];
+        const int len = snprintf(name, sizeof(name), "k%04lu", (unsigned long)((k + r->offset) % NUM_KEYS));
+
+        JsonNode_t* pair = JsonObjIndex_find(r->index, name);
+        if(pair == NULL || JsonObjIndex_find_key(r->index, name, (size_t)len) != pair) {
+            r->errors++;
+            continue;
+        }
+
+        int64_t value;
+        if(!JsonNumber_to_int64(r->src, JsonPair_field(pair), &value))
+            r->errors++;
+        sum += (uint64_t)value;
+    }
+    if(JsonObjIndex_find(r->index, "missing") != NULL)
+        r->errors++;
+
+    return mix(h, sum);
+}
+
+static void* reader_thread(void* arg) {
+    reader_t* r = (reader_t*)arg;
+    char* scratch = (char*)malloc(r->scratch_len);
+
+    uint64_t digest = 0ull;
+    size_t i;
+    for(i = 0ul; i < r->rounds; i++) {
+        const uint64_t d = read_document(r, scratch);
+        if(i > 0ul && d != digest)
+            r->errors++;
+        digest = d;
+    }
+
+    free(scratch);
+    r->digest = digest;
+    return NULL;
+}
+
+//
+// a config document with escaped and non-ASCII strings, dates,
+// numbers of every kind and one wide object for indexed lookups
+//
+static char* build_document(size_t* len) {
+    const size_t cap = 1ul << 20;
+    char* buf = (char*)malloc(cap);
+    size_t n = 0ul;
+
+    n += (size_t)snprintf(buf + n, cap - n,
+            "{\"service\":{\"name\":\"config \\\"main\\\"\",\"owner\":\"J\\u00f6rg \xc3\xa9\",\"version\":3,"
+            "\"started\":\"2024-02-29T12:34:56.789Z\",\"ratio\":-0.125,\"big\":1.5e3,\"debug\":false,\"extra\":null},"
+            "\"routes\":[");
+
+    int i;
+    for(i = 0; i < NUM_ROUTES; i++) {
+        n += (size_t)snprintf(buf + n, cap - n,
+                "%s{\"path\":\"/api/v%d/item\\/%d\",\"timeout\":%d,\"weight\":%d.%02d,\"retries\":-%d,"
+                "\"tags\":[\"t%d\",\"line\\nbreak\",\"\\ud83d\\ude00\"],\"updated\":\"2023-%02d-%02dT0%d:00:00Z\",\"enabled\":%s}",
+                i ? "," : "", i % 4, i, 100 + i, i % 3, i, i, i, i % 12 + 1, i % 28 + 1, i % 10, (i & 1) ? "true" : "false");
+    }
+    n += (size_t)snprintf(buf + n, cap - n, "],\"limits\":{");
+
+    for(i = 0; i < NUM_KEYS; i++)
+        n += (size_t)snprintf(buf + n, cap - n, "%s\"k%04d\":%d", i ? "," : "", i, i * 7 - 1000);
+
+    n += (size_t)snprintf(buf + n, cap - n, "}}");
+    *len = n;
+    return buf;
+}
+
+static JsonNode_t* test_alloc(void* const alloc_data) {
+    (void)alloc_data;
+    JsonNode_t* node = (JsonNode_t*)malloc(sizeof(JsonNode_t));
+    if(node == NULL)
+        return NULL;
+    node->type = JsonNodeType_none;
+    node->flags = 0u;
+    node->pair.key_start = 0;
+    node->pair.key_end   = 0;
+    node->pair.next      = NULL;
+    node->pair.value     = NULL;
+    return node;
+}
+
+static void test_dealloc(void* const alloc_data, JsonNode_t* node) {
+    (void)alloc_data;
+    free(node);
+}
+
+int main(int argc, char** argv) {
+    const size_t num_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 64ul;
+    const size_t rounds      = argc > 2 ? strtoul(argv[2], NULL, 10) : 20ul;
+    if(num_threads == 0ul || rounds == 0ul) {
+        printf("usage:\n    ./test-threads [threads] [rounds]\n\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t len;
+    char* src = build_document(&len);
+
+    JsonDocument_t doc;
+    JsonParser_init_document(&doc, test_dealloc, test_alloc, NULL);
+
+    JsonParseCode_t code = JsonParser_parse_document(&doc, src);
+    if(code != JsonParseCode_success) {
+        printf("failed to parse document : %s\n", JsonParseCode_as_string(code));
+        return EXIT_FAILURE;
+    }
+
+    // the index is built before the document is shared and only read afterwards
+    JsonNode_t* limits = JsonPair_field(JsonObj_field_by_name(src, doc.first, "limits"));
+    const size_t num_slots = JsonObjIndex_slots_needed(limits);
+    JsonNode_t** slots = (JsonNode_t**)malloc(num_slots * sizeof(JsonNode_t*));
+    JsonObjIndex_t index;
+    if(!JsonObjIndex_init(&index, src, limits, slots, num_slots)) {
+        printf("failed to build index\n");
+        return EXIT_FAILURE;
+    }
+
+    reader_t reference;
+    memset(&reference, 0, sizeof(reference));
+    reference.src         = src;
+    reference.root        = doc.first;
+    reference.index       = &index;
+    reference.rounds      = 1ul;
+    reference.scratch_len = len + 1ul;
+    reader_thread(&reference);
+
+    reader_t* readers = (reader_t*)malloc(num_threads * sizeof(reader_t));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+
+    size_t t;
+    for(t = 0ul; t < num_threads; t++) {
+        readers[t] = reference;
+        readers[t].rounds = rounds;
+        readers[t].offset = t * 37ul;
+        readers[t].digest = 0ull;
+        if(pthread_create(&threads[t], NULL, reader_thread, &readers[t]) != 0) {
+            printf("failed to start thread %lu\n", (unsigned long)t);
+            return EXIT_FAILURE;
+        }
+    }
+
+    unsigned long failures = reference.errors ? 1ul : 0ul;
+    for(t = 0ul; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        if(readers[t].errors != 0ul || readers[t].digest != reference.digest) {
+            printf("thread %lu : %lu errors, digest %016llx (expected %016llx)\n", (unsigned long)t,
+                    readers[t].errors, (unsigned long long)readers[t].digest, (unsigned long long)reference.digest);
+            failures++;
+        }
+    }
+
+    printf("%lu threads x %lu rounds on one document (%lu bytes) : %s\n",
+            (unsigned long)num_threads, (unsigned long)rounds, (unsigned long)len, failures ? "FAILED" : "ok");
+
+    free(threads);
+    free(readers);
+    free(slots);
+    JsonParser_delete_document(&doc);
+    free(src);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}